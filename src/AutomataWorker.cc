@@ -0,0 +1,122 @@
+#include "AutomataWorker.h"
+
+void AutomataWorker::Start(void (*threadSetup)()) {
+  mThread = std::thread(&AutomataWorker::Work, this, threadSetup);
+}
+
+void AutomataWorker::Stop() {
+  if (!mThread.joinable()) {
+    return;
+  }
+  AutomataCommand command = {};
+  command.mType = AutomataCommand::Type::Quit;
+  Send(std::move(command));
+  while (!mBacklog.empty()) {
+    std::this_thread::yield();
+    Flush();
+  }
+  mThread.join();
+}
+
+void AutomataWorker::Send(AutomataCommand&& command) {
+  mBacklog.push_back(std::move(command));
+  Flush();
+}
+
+void AutomataWorker::Flush() {
+  bool sent = false;
+  while (!mBacklog.empty() && mCommands.TryPush(std::move(mBacklog.front()))) {
+    mBacklog.pop_front();
+    sent = true;
+  }
+  if (sent) {
+    mWake.fetch_add(1, std::memory_order_release);
+    mWake.notify_one();
+  }
+}
+
+const AutomataSnapshot* AutomataWorker::Consume() {
+  if (!mSnapshots.Consume()) {
+    return nullptr;
+  }
+  return &mSnapshots.Front();
+}
+
+void AutomataWorker::Work(void (*threadSetup)()) {
+  if (threadSetup != nullptr) {
+    threadSetup();
+  }
+  AutomataCommand command = {};
+  while (!mQuit) {
+    // The wake count is read before the queue so a command pushed after the
+    // queue was found empty still ends the wait below.
+    uint32_t wake = mWake.load(std::memory_order_acquire);
+    while (!mQuit && mCommands.TryPop(&command)) {
+      HandleCommand(command);
+    }
+    if (mQuit) {
+      break;
+    }
+    if (mLoaded && mPendingSteps > 0) {
+      std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+      mSimulation.Step();
+      mStepTime = std::chrono::steady_clock::now() - start;
+      --mPendingSteps;
+      if (mSimulation.RequirementsMet()) {
+        mPendingSteps = 0;
+        mLoaded = false;
+      }
+      Publish();
+      continue;
+    }
+    mWake.wait(wake, std::memory_order_acquire);
+  }
+}
+
+void AutomataWorker::HandleCommand(AutomataCommand& command) {
+  switch (command.mType) {
+  case AutomataCommand::Type::Load:
+    mGeneration = command.mGeneration;
+    mLevel = std::move(command.mLevel);
+    mBoard.Init(mLevel);
+    for (int i = 0; i < mBoard.CellCount(); ++i) {
+      mBoard.SetModifier(i, command.mModifiers[i]);
+    }
+    mSimulation.Reset(mBoard);
+    mPendingSteps = 0;
+    mStepTime = {};
+    mLoaded = true;
+    Publish();
+    break;
+  case AutomataCommand::Type::Step:
+    if (command.mGeneration == mGeneration) {
+      mPendingSteps += command.mSteps;
+    }
+    break;
+  case AutomataCommand::Type::Pause: mPendingSteps = 0; break;
+  case AutomataCommand::Type::Quit: mQuit = true; break;
+  }
+}
+
+void AutomataWorker::Publish() {
+  AutomataSnapshot& snapshot = mSnapshots.Back();
+  snapshot.mGeneration = mGeneration;
+  snapshot.mTick = mSimulation.mTick;
+  // Like the game, requirements only count after a step.
+  snapshot.mRequirementsMet =
+    mSimulation.mTick > 0 && mSimulation.RequirementsMet();
+  snapshot.mDigitCount = mSimulation.mLiveCount;
+  snapshot.mStepMicroseconds =
+    std::chrono::duration<double, std::micro>(mStepTime).count();
+  snapshot.mCells.assign(mBoard.CellCount(), {false, 0, Direction::Up});
+  for (size_t i = 0; i < mSimulation.mDigits.size(); ++i) {
+    if (!mSimulation.mLive[i]) {
+      continue;
+    }
+    const Digit& digit = mSimulation.mDigits[i];
+    AutomataCell& cell = snapshot.mCells[mBoard.CellIndex(digit.mCell)];
+    cell = {true, digit.mValue, digit.mDirection};
+  }
+  mSnapshots.Publish();
+}
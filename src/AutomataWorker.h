@@ -0,0 +1,159 @@
+#ifndef AutomataWorker_h
+#define AutomataWorker_h
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Simulation.h"
+
+// A single writer, single reader handoff of the newest value. The writer fills
+// the back buffer and swaps it with the middle one. The reader swaps the
+// middle buffer with the front one when the middle holds something newer.
+// Neither side ever waits on the other.
+template<typename T>
+struct TripleBuffer {
+  // Writer only.
+  T& Back() {
+    return mBuffers[mBack];
+  }
+  void Publish() {
+    mBack = mMiddle.exchange(mBack | smFresh, std::memory_order_acq_rel) &
+      smIndexMask;
+  }
+
+  // Reader only. Returns false when nothing was published since the last call.
+  bool Consume() {
+    if ((mMiddle.load(std::memory_order_relaxed) & smFresh) == 0) {
+      return false;
+    }
+    mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & smIndexMask;
+    return true;
+  }
+  const T& Front() const {
+    return mBuffers[mFront];
+  }
+
+  static constexpr int smFresh = 4;
+  static constexpr int smIndexMask = 3;
+  T mBuffers[3];
+  int mBack = 0;
+  std::atomic<int> mMiddle = 1;
+  int mFront = 2;
+};
+
+// A bounded single producer, single consumer queue.
+template<typename T, size_t Capacity>
+struct SpscQueue {
+  // Producer only. Returns false when the queue is full.
+  bool TryPush(T&& value) {
+    size_t tail = mTail.load(std::memory_order_relaxed);
+    if (tail - mHead.load(std::memory_order_acquire) == Capacity) {
+      return false;
+    }
+    mSlots[tail % Capacity] = std::move(value);
+    mTail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only. Returns false when the queue is empty.
+  bool TryPop(T* value) {
+    size_t head = mHead.load(std::memory_order_relaxed);
+    if (head == mTail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *value = std::move(mSlots[head % Capacity]);
+    mHead.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  T mSlots[Capacity];
+  alignas(64) std::atomic<size_t> mHead = 0;
+  alignas(64) std::atomic<size_t> mTail = 0;
+};
+
+// Sent from the frame thread. Every load starts a new generation and commands
+// or snapshots from another generation are ignored, so a reset never shows
+// digits from the board before it.
+struct AutomataCommand {
+  enum class Type {
+    // Replaces the board with mLevel and mModifiers (see Sim::Board).
+    Load,
+    // Queues mSteps more steps.
+    Step,
+    // Drops the steps that haven't happened yet.
+    Pause,
+    Quit,
+  };
+  Type mType;
+  int mGeneration;
+  int mSteps;
+  Sim::LevelDesc mLevel;
+  std::vector<int> mModifiers;
+};
+
+// What a cell of the board shows. When several digits share a cell, the last
+// live one in step order is shown.
+struct AutomataCell {
+  bool mOccupied;
+  int mValue;
+  Direction mDirection;
+};
+
+// An immutable picture of the board after a step. It holds one entry per
+// cell rather than per digit, so the frame thread's work doesn't grow with the
+// number of live digits.
+struct AutomataSnapshot {
+  int mGeneration = -1;
+  int mTick = 0;
+  bool mRequirementsMet = false;
+  int mDigitCount = 0;
+  // The time the worker spent on the step that led here, 0 after a load.
+  double mStepMicroseconds = 0.0;
+  std::vector<AutomataCell> mCells;
+};
+
+// Runs the automata on its own thread so a slow step never holds up a frame.
+// The frame thread sends commands and reads the newest snapshot. The worker
+// sleeps whenever it has no steps left.
+struct AutomataWorker {
+  // threadSetup runs first thing on the worker thread when given.
+  void Start(void (*threadSetup)() = nullptr);
+  void Stop();
+
+  // Frame thread only. Commands the queue has no room for wait in a backlog
+  // that is retried on the next send or flush.
+  void Send(AutomataCommand&& command);
+  void Flush();
+  // Returns the newest snapshot when one was published since the last call.
+  const AutomataSnapshot* Consume();
+
+private:
+  void Work(void (*threadSetup)());
+  void HandleCommand(AutomataCommand& command);
+  void Publish();
+
+  SpscQueue<AutomataCommand, 64> mCommands;
+  std::deque<AutomataCommand> mBacklog;
+  TripleBuffer<AutomataSnapshot> mSnapshots;
+  // Bumped with every command so the sleeping worker wakes up.
+  std::atomic<uint32_t> mWake = 0;
+  std::thread mThread;
+
+  // Worker only.
+  Sim::LevelDesc mLevel;
+  Sim::Board mBoard;
+  Sim::Simulation mSimulation;
+  int mGeneration = -1;
+  int mPendingSteps = 0;
+  std::chrono::steady_clock::duration mStepTime{};
+  bool mLoaded = false;
+  bool mQuit = false;
+};
+
+#endif
@@ -0,0 +1,99 @@
+// Measures how many steps per second the simulation manages with many live
+// digits. The field is a stack of lanes. Every lane has an emitter that puts a
+// digit on its left end every tick and a sink on its right end, with locked
+// filters along the way, so every step spawns and despawns one digit per lane
+// while the number of live digits stays the same.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Simulation.h"
+
+constexpr int nLaneLength = 100;
+constexpr int nFilterSpacing = 10;
+
+Sim::LevelDesc MakeLanes(int laneCount) {
+  Sim::LevelDesc level;
+  level.mWidth = nLaneLength + 2;
+  level.mHeight = laneCount;
+  for (int y = 0; y < laneCount; ++y) {
+    level.mEmitters.push_back({{0, y}, y % 10, Direction::Right, 1});
+    level.mSinks.push_back({{nLaneLength + 1, y}});
+    for (int x = nFilterSpacing; x <= nLaneLength; x += nFilterSpacing) {
+      level.mFilters.push_back({{x, y}, 1, Filter::Type::Add, false});
+    }
+  }
+  // Levels need one, but this one is never met.
+  level.mRequirements.push_back({{1, 0}, 5});
+  return level;
+}
+
+void Measure(int digitCount, std::chrono::milliseconds duration) {
+  // A lane holds one digit per cell between its emitter and sink, plus the
+  // one just emitted.
+  int laneSize = nLaneLength + 1;
+  int laneCount = std::max(1, (digitCount + laneSize / 2) / laneSize);
+  Sim::LevelDesc level = MakeLanes(laneCount);
+  Sim::Board board;
+  board.Init(level);
+  Sim::Simulation simulation;
+  simulation.Reset(board);
+  while (simulation.mTick <= nLaneLength) {
+    simulation.Step();
+  }
+
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+  Clock::duration elapsed;
+  int steps = 0;
+  do {
+    // The clock is only read every few steps so it doesn't dominate small
+    // fields.
+    for (int i = 0; i < 16; ++i) {
+      simulation.Step();
+    }
+    steps += 16;
+    elapsed = Clock::now() - start;
+  } while (elapsed < duration);
+
+  double seconds = std::chrono::duration<double>(elapsed).count();
+  double stepRate = steps / seconds;
+  std::printf(
+    "%7d digits: %10.0f steps/s %12.0f digit steps/s "
+    "%d spawns and despawns per step\n",
+    simulation.mLiveCount,
+    stepRate,
+    stepRate * simulation.mLiveCount,
+    laneCount);
+}
+
+int main(int argc, char* argv[]) {
+  std::vector<int> digitCounts;
+  int timeMs = 1000;
+  for (int i = 1; i < argc; ++i) {
+    bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--digits") == 0 && hasValue) {
+      digitCounts.push_back(std::max(1, std::atoi(argv[++i])));
+    }
+    else if (std::strcmp(argv[i], "--time") == 0 && hasValue) {
+      timeMs = std::max(1, std::atoi(argv[++i]));
+    }
+    else {
+      std::fprintf(
+        stderr,
+        "usage: %s [--digits n]... [--time ms]\n"
+        "  Measures 1000, 10000 and 100000 digits when no count is given.\n",
+        argv[0]);
+      return 1;
+    }
+  }
+  if (digitCounts.empty()) {
+    digitCounts = {1000, 10000, 100000};
+  }
+  for (int digitCount: digitCounts) {
+    Measure(digitCount, std::chrono::milliseconds(timeMs));
+  }
+}
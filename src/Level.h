@@ -0,0 +1,556 @@
+#ifndef Level_h
+#define Level_h
+
+#include <iterator>
+#include <span>
+#include <string_view>
+
+// This is a cellular automata type game. There are three primary game elements.
+
+// Requirement - A requirment occupies 2 cells, both of which can be anywhere on
+// the grid. One of the cells signifies a physical digit. The other cell
+// signifies the filtered digit.
+
+// Shifter - An arrow pointing in one of four directions. When a physical digit
+// arrives at a shifter, the physical digit begins to move in the direction the
+// arrow points.
+
+// Filter - When a physical digit arrives at the cell occupied by a filter, the
+// filter changes the digit, e.g. +1, *2, -5.
+
+// Emitter - Puts a new physical digit with a given value and direction on its
+// cell every few ticks.
+
+// Sink - Consumes every physical digit that arrives at its cell.
+
+// The goal is to place a set of filters and shifters, such that the physical
+// digits arrive at the filtered digits with the same values.
+
+enum class Direction { Up, Right, Down, Left };
+
+constexpr int nFieldWidth = 10;
+constexpr int nFieldHeight = 10;
+
+struct Digit {
+  int mCell[2];
+  int mValue;
+  Direction mDirection;
+};
+struct Requirement {
+  int mCell[2];
+  int mValue;
+};
+struct Filter {
+  int mStartCell[2];
+  int mValue;
+  enum class Type { Add, Sub, Mul, Mod };
+  Type mType;
+  bool mPlaceable;
+};
+struct Shifter {
+  int mStartCell[2];
+  Direction mDirection;
+  bool mPlaceable;
+};
+
+struct Emitter {
+  int mCell[2];
+  int mValue;
+  Direction mDirection;
+  // Digits appear on ticks that are a multiple of the period, starting with
+  // tick 0.
+  int mPeriod;
+};
+struct Sink {
+  int mCell[2];
+};
+
+struct Level {
+  std::string_view mName;
+  std::span<const Digit> mDigits;
+  std::span<const Requirement> mRequirements;
+  std::span<const Filter> mFilters;
+  std::span<const Shifter> mShifters;
+  std::span<const Emitter> mEmitters = {};
+  std::span<const Sink> mSinks = {};
+};
+
+// Returns the value a digit leaves a filter with.
+constexpr int ApplyFilter(const Filter& filter, int value) {
+  switch (filter.mType) {
+  case Filter::Type::Add: value = value + filter.mValue; break;
+  case Filter::Type::Sub: value = value - filter.mValue; break;
+  case Filter::Type::Mul: value = value * filter.mValue; break;
+  case Filter::Type::Mod: value = value % filter.mValue; break;
+  }
+  return (value % 10 + 10) % 10;
+}
+
+constexpr bool SameCell(const int cellA[2], const int cellB[2]) {
+  return cellA[0] == cellB[0] && cellA[1] == cellB[1];
+}
+
+constexpr bool CellInField(const int cell[2], int width, int height) {
+  return cell[0] >= 0 && cell[0] < width && cell[1] >= 0 && cell[1] < height;
+}
+
+constexpr bool LockedModifierAt(const Level& level, const int cell[2]) {
+  for (const Filter& filter: level.mFilters) {
+    if (!filter.mPlaceable && SameCell(filter.mStartCell, cell)) {
+      return true;
+    }
+  }
+  for (const Shifter& shifter: level.mShifters) {
+    if (!shifter.mPlaceable && SameCell(shifter.mStartCell, cell)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Emitters and sinks keep their cells for the whole level like locked
+// modifiers, so nothing else can share them.
+constexpr bool FixtureAt(const Level& level, const int cell[2]) {
+  for (const Emitter& emitter: level.mEmitters) {
+    if (SameCell(emitter.mCell, cell)) {
+      return true;
+    }
+  }
+  for (const Sink& sink: level.mSinks) {
+    if (SameCell(sink.mCell, cell)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Each of these calls fail with a message for the first problem found in the
+// level and returns false.
+
+// Checks that there are digits and requirements and that every element has
+// its cell in the field and a value in range. This comes first, so the cells
+// of a level that passes can be used as indices.
+template<typename FailFn>
+constexpr bool ValidateElements(
+  const Level& level, int width, int height, FailFn fail) {
+  bool noDigits = level.mDigits.empty() && level.mEmitters.empty();
+  if (noDigits || level.mRequirements.empty()) {
+    fail("Levels need at least one digit or emitter and one requirement.");
+    return false;
+  }
+  for (const Digit& digit: level.mDigits) {
+    if (!CellInField(digit.mCell, width, height)) {
+      fail("Digit cell is outside of the field.");
+      return false;
+    }
+    if (digit.mValue < 0 || digit.mValue > 9) {
+      fail("Digit value is not a single digit.");
+      return false;
+    }
+  }
+  for (const Requirement& requirement: level.mRequirements) {
+    if (!CellInField(requirement.mCell, width, height)) {
+      fail("Requirement cell is outside of the field.");
+      return false;
+    }
+    if (requirement.mValue < 0 || requirement.mValue > 9) {
+      fail("Requirement value is not a single digit.");
+      return false;
+    }
+  }
+
+  // Placeable modifiers start in the palette, so only the cells of locked
+  // modifiers matter.
+  for (const Filter& filter: level.mFilters) {
+    if (filter.mType == Filter::Type::Mod && filter.mValue == 0) {
+      fail("Mod filters can't have a value of zero.");
+      return false;
+    }
+    if (!filter.mPlaceable && !CellInField(filter.mStartCell, width, height)) {
+      fail("Locked filter cell is outside of the field.");
+      return false;
+    }
+  }
+  for (const Shifter& shifter: level.mShifters) {
+    if (
+      !shifter.mPlaceable && !CellInField(shifter.mStartCell, width, height)) {
+      fail("Locked shifter cell is outside of the field.");
+      return false;
+    }
+  }
+
+  for (const Emitter& emitter: level.mEmitters) {
+    if (!CellInField(emitter.mCell, width, height)) {
+      fail("Emitter cell is outside of the field.");
+      return false;
+    }
+    if (emitter.mValue < 0 || emitter.mValue > 9) {
+      fail("Emitter value is not a single digit.");
+      return false;
+    }
+    if (emitter.mPeriod <= 0) {
+      fail("Emitter period must be positive.");
+      return false;
+    }
+  }
+  for (const Sink& sink: level.mSinks) {
+    if (!CellInField(sink.mCell, width, height)) {
+      fail("Sink cell is outside of the field.");
+      return false;
+    }
+  }
+  return true;
+}
+
+// Checks that no two elements share a cell they can't. Digits go anywhere but
+// on emitters and sinks. Requirements can't share a cell with each other, a
+// locked modifier, an emitter or a sink, and neither can locked modifiers,
+// emitters and sinks. Every pair is compared, which is only meant for the
+// small built in tables. Sim::ValidLevelDesc checks runtime levels in linear
+// time with the same messages.
+template<typename FailFn>
+constexpr bool ValidateSharedCells(const Level& level, FailFn fail) {
+  for (size_t i = 0; i < level.mRequirements.size(); ++i) {
+    const Requirement& requirement = level.mRequirements[i];
+    if (LockedModifierAt(level, requirement.mCell)) {
+      fail("Requirement is on top of a locked modifier.");
+      return false;
+    }
+    for (size_t j = 0; j < i; ++j) {
+      if (SameCell(level.mRequirements[j].mCell, requirement.mCell)) {
+        fail("Two requirements share a cell.");
+        return false;
+      }
+    }
+  }
+  for (size_t i = 0; i < level.mFilters.size(); ++i) {
+    const Filter& filter = level.mFilters[i];
+    if (filter.mPlaceable) {
+      continue;
+    }
+    for (size_t j = 0; j < i; ++j) {
+      const Filter& other = level.mFilters[j];
+      if (!other.mPlaceable && SameCell(other.mStartCell, filter.mStartCell)) {
+        fail("Two locked modifiers share a cell.");
+        return false;
+      }
+    }
+  }
+  for (size_t i = 0; i < level.mShifters.size(); ++i) {
+    const Shifter& shifter = level.mShifters[i];
+    if (shifter.mPlaceable) {
+      continue;
+    }
+    bool sharedCell = false;
+    for (const Filter& filter: level.mFilters) {
+      sharedCell |=
+        !filter.mPlaceable && SameCell(filter.mStartCell, shifter.mStartCell);
+    }
+    for (size_t j = 0; j < i; ++j) {
+      const Shifter& other = level.mShifters[j];
+      sharedCell |=
+        !other.mPlaceable && SameCell(other.mStartCell, shifter.mStartCell);
+    }
+    if (sharedCell) {
+      fail("Two locked modifiers share a cell.");
+      return false;
+    }
+  }
+
+  for (size_t i = 0; i < level.mEmitters.size(); ++i) {
+    const Emitter& emitter = level.mEmitters[i];
+    for (size_t j = 0; j < i; ++j) {
+      if (SameCell(level.mEmitters[j].mCell, emitter.mCell)) {
+        fail("Two emitters share a cell.");
+        return false;
+      }
+    }
+  }
+  for (size_t i = 0; i < level.mSinks.size(); ++i) {
+    const Sink& sink = level.mSinks[i];
+    for (const Emitter& emitter: level.mEmitters) {
+      if (SameCell(emitter.mCell, sink.mCell)) {
+        fail("An emitter and a sink share a cell.");
+        return false;
+      }
+    }
+    for (size_t j = 0; j < i; ++j) {
+      if (SameCell(level.mSinks[j].mCell, sink.mCell)) {
+        fail("Two sinks share a cell.");
+        return false;
+      }
+    }
+  }
+  for (const Digit& digit: level.mDigits) {
+    if (FixtureAt(level, digit.mCell)) {
+      fail("Digit is on top of an emitter or sink.");
+      return false;
+    }
+  }
+  for (const Requirement& requirement: level.mRequirements) {
+    if (FixtureAt(level, requirement.mCell)) {
+      fail("Requirement is on top of an emitter or sink.");
+      return false;
+    }
+  }
+  for (const Filter& filter: level.mFilters) {
+    if (!filter.mPlaceable && FixtureAt(level, filter.mStartCell)) {
+      fail("Locked modifier is on top of an emitter or sink.");
+      return false;
+    }
+  }
+  for (const Shifter& shifter: level.mShifters) {
+    if (!shifter.mPlaceable && FixtureAt(level, shifter.mStartCell)) {
+      fail("Locked modifier is on top of an emitter or sink.");
+      return false;
+    }
+  }
+  return true;
+}
+
+// Used on the built in tables at compile time.
+template<typename FailFn>
+constexpr bool ValidateLevel(
+  const Level& level, int width, int height, FailFn fail) {
+  return ValidateElements(level, width, height, fail) &&
+    ValidateSharedCells(level, fail);
+}
+
+// The built in levels are constant tables. Each level's elements live in their
+// own arrays and the Level entries in nLevels only view them, so nothing is
+// constructed at startup.
+
+// Need Some Space
+constexpr Digit nNeedSomeSpaceDigits[] = {
+  {{5, 3}, 2, Direction::Up},
+};
+constexpr Requirement nNeedSomeSpaceRequirements[] = {
+  {{5, 7}, 4},
+};
+constexpr Filter nNeedSomeSpaceFilters[] = {
+  {{5, 5}, 2, Filter::Type::Add, false},
+};
+
+// Operation Order
+constexpr Digit nOperationOrderDigits[] = {
+  {{2, 5}, 1, Direction::Right},
+};
+constexpr Requirement nOperationOrderRequirements[] = {
+  {{8, 5}, 9},
+};
+constexpr Filter nOperationOrderFilters[] = {
+  {{5, 5}, 3, Filter::Type::Mul, false},
+  {{5, 5}, 6, Filter::Type::Add, true},
+};
+
+// Get Shifty
+constexpr Digit nGetShiftyDigits[] = {
+  {{3, 8}, 3, Direction::Down},
+};
+constexpr Requirement nGetShiftyRequirements[] = {
+  {{6, 3}, 9},
+};
+constexpr Filter nGetShiftyFilters[] = {
+  {{5, 3}, 3, Filter::Type::Mul, false},
+};
+constexpr Shifter nGetShiftyShifters[] = {
+  {{-1, -1}, Direction::Right, true},
+};
+
+// Get Back
+constexpr Digit nGetBackDigits[] = {
+  {{7, 6}, 0, Direction::Left},
+};
+constexpr Requirement nGetBackRequirements[] = {
+  {{5, 6}, 8},
+};
+constexpr Filter nGetBackFilters[] = {
+  {{-1, -1}, 4, Filter::Type::Add, true},
+};
+constexpr Shifter nGetBackShifters[] = {
+  {{-1, -1}, Direction::Right, true},
+};
+
+// ABC...
+constexpr Digit nAbcDigits[] = {
+  {{6, 4}, 1, Direction::Up},
+};
+constexpr Requirement nAbcRequirements[] = {
+  {{6, 6}, 7},
+};
+constexpr Filter nAbcFilters[] = {
+  {{-1, -1}, 1, Filter::Type::Add, true},
+};
+constexpr Shifter nAbcShifters[] = {
+  {{6, 7}, Direction::Down, false},
+  {{-1, -1}, Direction::Up, true},
+};
+
+// Poor Timing?
+constexpr Digit nPoorTimingDigits[] = {
+  {{3, 7}, 6, Direction::Right},
+  {{6, 7}, 6, Direction::Left},
+};
+constexpr Requirement nPoorTimingRequirements[] = {
+  {{2, 1}, 6},
+  {{7, 5}, 6},
+};
+constexpr Shifter nPoorTimingShifters[] = {
+  {{2, 7}, Direction::Down, false},
+  {{-1, -1}, Direction::Down, true},
+  {{-1, -1}, Direction::Up, true},
+};
+
+// Together We Stand
+constexpr Digit nTogetherWeStandDigits[] = {
+  {{2, 7}, 8, Direction::Down},
+  {{7, 2}, 8, Direction::Up},
+};
+constexpr Requirement nTogetherWeStandRequirements[] = {
+  {{9, 3}, 0},
+  {{1, 7}, 0},
+};
+constexpr Filter nTogetherWeStandFilters[] = {
+  {{-1, -1}, 8, Filter::Type::Sub, true},
+};
+constexpr Shifter nTogetherWeStandShifters[] = {
+  {{-1, -1}, Direction::Left, true},
+  {{-1, -1}, Direction::Right, true},
+};
+
+// Stay In Line
+constexpr Digit nStayInLineDigits[] = {
+  {{2, 2}, 4, Direction::Right},
+  {{7, 2}, 5, Direction::Left},
+};
+constexpr Requirement nStayInLineRequirements[] = {
+  {{4, 7}, 8},
+  {{4, 6}, 4},
+};
+constexpr Filter nStayInLineFilters[] = {
+  {{4, 5}, 2, Filter::Type::Mul, false},
+  {{-1, -1}, 3, Filter::Type::Sub, true},
+};
+constexpr Shifter nStayInLineShifters[] = {
+  {{-1, -1}, Direction::Up, true},
+};
+
+// Off By One
+constexpr Digit nOffByOneDigits[] = {
+  {{5, 3}, 0, Direction::Up},
+  {{6, 5}, 0, Direction::Left},
+  {{4, 6}, 0, Direction::Down},
+  {{3, 4}, 0, Direction::Right},
+};
+constexpr Requirement nOffByOneRequirements[] = {
+  {{4, 3}, 4},
+  {{6, 4}, 4},
+  {{5, 6}, 5},
+  {{3, 5}, 5},
+};
+constexpr Filter nOffByOneFilters[] = {
+  {{5, 4}, 1, Filter::Type::Add, false},
+  {{5, 5}, 1, Filter::Type::Add, false},
+  {{-1, -1}, 1, Filter::Type::Add, true},
+};
+constexpr Shifter nOffByOneShifters[] = {
+  {{4, 2}, Direction::Right, false},
+  {{5, 2}, Direction::Up, false},
+  {{5, 7}, Direction::Left, false},
+  {{4, 7}, Direction::Down, false},
+  {{2, 5}, Direction::Down, false},
+  {{2, 4}, Direction::Right, false},
+  {{7, 4}, Direction::Up, false},
+  {{7, 5}, Direction::Left, false},
+};
+
+// Steady Stream
+constexpr Requirement nSteadyStreamRequirements[] = {
+  {{3, 6}, 4},
+  {{6, 7}, 6},
+};
+constexpr Filter nSteadyStreamFilters[] = {
+  {{-1, -1}, 2, Filter::Type::Add, true},
+  {{-1, -1}, 2, Filter::Type::Add, true},
+};
+constexpr Shifter nSteadyStreamShifters[] = {
+  {{-1, -1}, Direction::Right, true},
+};
+constexpr Emitter nSteadyStreamEmitters[] = {
+  {{3, 0}, 2, Direction::Up, 2},
+};
+constexpr Sink nSteadyStreamSinks[] = {
+  {{9, 7}},
+};
+
+constexpr Level nLevels[] = {
+  {"Need Some Space",
+   nNeedSomeSpaceDigits,
+   nNeedSomeSpaceRequirements,
+   nNeedSomeSpaceFilters,
+   {}},
+  {"Operation Order",
+   nOperationOrderDigits,
+   nOperationOrderRequirements,
+   nOperationOrderFilters,
+   {}},
+  {"Get Shifty",
+   nGetShiftyDigits,
+   nGetShiftyRequirements,
+   nGetShiftyFilters,
+   nGetShiftyShifters},
+  {"Get Back",
+   nGetBackDigits,
+   nGetBackRequirements,
+   nGetBackFilters,
+   nGetBackShifters},
+  {"ABC...", nAbcDigits, nAbcRequirements, nAbcFilters, nAbcShifters},
+  {"Poor Timing?",
+   nPoorTimingDigits,
+   nPoorTimingRequirements,
+   {},
+   nPoorTimingShifters},
+  {"Together We Stand",
+   nTogetherWeStandDigits,
+   nTogetherWeStandRequirements,
+   nTogetherWeStandFilters,
+   nTogetherWeStandShifters},
+  {"Stay In Line",
+   nStayInLineDigits,
+   nStayInLineRequirements,
+   nStayInLineFilters,
+   nStayInLineShifters},
+  {"Off By One",
+   nOffByOneDigits,
+   nOffByOneRequirements,
+   nOffByOneFilters,
+   nOffByOneShifters},
+  {"Steady Stream",
+   {},
+   nSteadyStreamRequirements,
+   nSteadyStreamFilters,
+   nSteadyStreamShifters,
+   nSteadyStreamEmitters,
+   nSteadyStreamSinks},
+};
+constexpr int nLevelCount = (int)std::size(nLevels);
+
+// This is deliberately not constexpr. Calling it while validating the level
+// tables makes the constant evaluation fail and the message shows up in the
+// compiler's diagnostic.
+inline void InvalidLevelData(const char* /*message*/) {}
+
+consteval bool ValidateLevels() {
+  for (const Level& level: nLevels) {
+    if (level.mName.empty()) {
+      InvalidLevelData("Levels must have a name.");
+    }
+    ValidateLevel(level, nFieldWidth, nFieldHeight, [](const char* message) {
+      InvalidLevelData(message);
+    });
+  }
+  return true;
+}
+static_assert(ValidateLevels());
+
+#endif
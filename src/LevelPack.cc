@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+#include "LevelPack.h"
+#include "Solver.h"
+
+namespace Pack {
+
+// Every symmetry is a linear map of cell offsets followed by a translation
+// that brings the field back onto itself. The map is stored as the images of
+// the x and y unit offsets.
+constexpr int nSymmetryAxes[nSymmetryCount][2][2] = {
+  {{1, 0}, {0, 1}},
+  {{-1, 0}, {0, 1}},
+  {{1, 0}, {0, -1}},
+  {{-1, 0}, {0, -1}},
+  {{0, 1}, {1, 0}},
+  {{0, 1}, {-1, 0}},
+  {{0, -1}, {1, 0}},
+  {{0, -1}, {-1, 0}},
+};
+
+bool SwapsAxes(int symmetry) {
+  return nSymmetryAxes[symmetry][0][0] == 0;
+}
+
+// The offset and out can be the same array.
+void TransformOffset(int symmetry, const int offset[2], int out[2]) {
+  const int(&axes)[2][2] = nSymmetryAxes[symmetry];
+  int x = offset[0];
+  int y = offset[1];
+  out[0] = axes[0][0] * x + axes[1][0] * y;
+  out[1] = axes[0][1] * x + axes[1][1] * y;
+}
+
+void TransformCell(
+  const Sim::LevelDesc& levelDesc,
+  int symmetry,
+  const int cell[2],
+  int out[2]) {
+  TransformOffset(symmetry, cell, out);
+  // The image of the field's far corner tells which axes were flipped.
+  int corner[2] = {levelDesc.mWidth - 1, levelDesc.mHeight - 1};
+  int cornerOut[2];
+  TransformOffset(symmetry, corner, cornerOut);
+  for (int i = 0; i < 2; ++i) {
+    if (cornerOut[i] < 0) {
+      out[i] -= cornerOut[i];
+    }
+  }
+}
+
+Direction TransformDirection(int symmetry, Direction direction) {
+  int offset[2] = {0, 0};
+  switch (direction) {
+  case Direction::Up: offset[1] = 1; break;
+  case Direction::Right: offset[0] = 1; break;
+  case Direction::Down: offset[1] = -1; break;
+  case Direction::Left: offset[0] = -1; break;
+  }
+  int out[2];
+  TransformOffset(symmetry, offset, out);
+  if (out[1] == 1) {
+    return Direction::Up;
+  }
+  if (out[0] == 1) {
+    return Direction::Right;
+  }
+  if (out[1] == -1) {
+    return Direction::Down;
+  }
+  return Direction::Left;
+}
+
+Sim::LevelDesc TransformLevel(const Sim::LevelDesc& levelDesc, int symmetry) {
+  Sim::LevelDesc transformed = levelDesc;
+  if (SwapsAxes(symmetry)) {
+    std::swap(transformed.mWidth, transformed.mHeight);
+  }
+  for (Digit& digit: transformed.mDigits) {
+    TransformCell(levelDesc, symmetry, digit.mCell, digit.mCell);
+    digit.mDirection = TransformDirection(symmetry, digit.mDirection);
+  }
+  for (Requirement& requirement: transformed.mRequirements) {
+    TransformCell(levelDesc, symmetry, requirement.mCell, requirement.mCell);
+  }
+  for (Filter& filter: transformed.mFilters) {
+    if (!filter.mPlaceable) {
+      TransformCell(levelDesc, symmetry, filter.mStartCell, filter.mStartCell);
+    }
+  }
+  for (Shifter& shifter: transformed.mShifters) {
+    shifter.mDirection = TransformDirection(symmetry, shifter.mDirection);
+    if (!shifter.mPlaceable) {
+      TransformCell(
+        levelDesc, symmetry, shifter.mStartCell, shifter.mStartCell);
+    }
+  }
+  for (Emitter& emitter: transformed.mEmitters) {
+    TransformCell(levelDesc, symmetry, emitter.mCell, emitter.mCell);
+    emitter.mDirection = TransformDirection(symmetry, emitter.mDirection);
+  }
+  for (Sink& sink: transformed.mSinks) {
+    TransformCell(levelDesc, symmetry, sink.mCell, sink.mCell);
+  }
+  return transformed;
+}
+
+// Placeables start in the palette, so whatever cell they list is ignored.
+void ClearPlaceableCells(Sim::LevelDesc& levelDesc) {
+  for (Filter& filter: levelDesc.mFilters) {
+    if (filter.mPlaceable) {
+      filter.mStartCell[0] = -1;
+      filter.mStartCell[1] = -1;
+    }
+  }
+  for (Shifter& shifter: levelDesc.mShifters) {
+    if (shifter.mPlaceable) {
+      shifter.mStartCell[0] = -1;
+      shifter.mStartCell[1] = -1;
+    }
+  }
+}
+
+template<typename T, typename KeyFn>
+void SortBy(std::vector<T>& elements, KeyFn keyFn) {
+  std::sort(elements.begin(), elements.end(), [&](const T& a, const T& b) {
+    return keyFn(a) < keyFn(b);
+  });
+}
+
+// Digits and emitters keep their order. It decides which of two digits on a
+// cell wins the digit layer and with it which requirements are met.
+void SortElements(Sim::LevelDesc& levelDesc) {
+  SortBy(levelDesc.mRequirements, [](const Requirement& requirement) {
+    return std::tuple(
+      requirement.mCell[1], requirement.mCell[0], requirement.mValue);
+  });
+  SortBy(levelDesc.mFilters, [](const Filter& filter) {
+    return std::tuple(
+      filter.mPlaceable,
+      filter.mStartCell[1],
+      filter.mStartCell[0],
+      filter.mType,
+      filter.mValue);
+  });
+  SortBy(levelDesc.mShifters, [](const Shifter& shifter) {
+    return std::tuple(
+      shifter.mPlaceable,
+      shifter.mStartCell[1],
+      shifter.mStartCell[0],
+      shifter.mDirection);
+  });
+  SortBy(levelDesc.mSinks, [](const Sink& sink) {
+    return std::tuple(sink.mCell[1], sink.mCell[0]);
+  });
+}
+
+std::vector<int> LevelKey(const Sim::LevelDesc& levelDesc) {
+  std::vector<int> key = {levelDesc.mWidth, levelDesc.mHeight};
+  key.push_back((int)levelDesc.mDigits.size());
+  for (const Digit& digit: levelDesc.mDigits) {
+    key.insert(
+      key.end(),
+      {digit.mCell[0], digit.mCell[1], digit.mValue, (int)digit.mDirection});
+  }
+  key.push_back((int)levelDesc.mRequirements.size());
+  for (const Requirement& requirement: levelDesc.mRequirements) {
+    key.insert(
+      key.end(),
+      {requirement.mCell[0], requirement.mCell[1], requirement.mValue});
+  }
+  key.push_back((int)levelDesc.mFilters.size());
+  for (const Filter& filter: levelDesc.mFilters) {
+    key.insert(
+      key.end(),
+      {filter.mStartCell[0],
+       filter.mStartCell[1],
+       (int)filter.mType,
+       filter.mValue,
+       filter.mPlaceable});
+  }
+  key.push_back((int)levelDesc.mShifters.size());
+  for (const Shifter& shifter: levelDesc.mShifters) {
+    key.insert(
+      key.end(),
+      {shifter.mStartCell[0],
+       shifter.mStartCell[1],
+       (int)shifter.mDirection,
+       shifter.mPlaceable});
+  }
+  key.push_back((int)levelDesc.mEmitters.size());
+  for (const Emitter& emitter: levelDesc.mEmitters) {
+    key.insert(
+      key.end(),
+      {emitter.mCell[0],
+       emitter.mCell[1],
+       emitter.mValue,
+       (int)emitter.mDirection,
+       emitter.mPeriod});
+  }
+  key.push_back((int)levelDesc.mSinks.size());
+  for (const Sink& sink: levelDesc.mSinks) {
+    key.insert(key.end(), {sink.mCell[0], sink.mCell[1]});
+  }
+  return key;
+}
+
+Sim::LevelDesc CanonicalLevel(const Sim::LevelDesc& levelDesc, int* symmetry) {
+  Sim::LevelDesc best;
+  std::vector<int> bestKey;
+  for (int i = 0; i < nSymmetryCount; ++i) {
+    Sim::LevelDesc transformed = TransformLevel(levelDesc, i);
+    ClearPlaceableCells(transformed);
+    SortElements(transformed);
+    std::vector<int> key = LevelKey(transformed);
+    if (i == 0 || key < bestKey) {
+      best = std::move(transformed);
+      bestKey = std::move(key);
+      *symmetry = i;
+    }
+  }
+  return best;
+}
+
+uint64_t CanonicalHash(const Sim::LevelDesc& levelDesc) {
+  int symmetry;
+  return Solver::HashLevelDesc(CanonicalLevel(levelDesc, &symmetry), 0);
+}
+
+} // namespace Pack
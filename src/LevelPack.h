@@ -0,0 +1,42 @@
+#ifndef LevelPack_h
+#define LevelPack_h
+
+#include <cstdint>
+#include <vector>
+
+#include "Simulation.h"
+
+// Tools for packs of levels. Packs are plain sequences of requests in the
+// format described in SolverProtocol.h.
+namespace Pack {
+
+// The symmetries of the field. The first four keep the axes. The last four
+// swap them, which turns a W by H field into an H by W one.
+constexpr int nSymmetryCount = 8;
+bool SwapsAxes(int symmetry);
+// The cell and out can be the same array.
+void TransformCell(
+  const Sim::LevelDesc& levelDesc,
+  int symmetry,
+  const int cell[2],
+  int out[2]);
+Direction TransformDirection(int symmetry, Direction direction);
+// Moves every cell and turns every direction of a level, swapping its width
+// and height when the symmetry swaps the axes. Placeables keep their cells of
+// (-1, -1) because they start in the palette.
+Sim::LevelDesc TransformLevel(const Sim::LevelDesc& levelDesc, int symmetry);
+
+// Levels that are the same puzzle under a symmetry of the field, or with
+// their requirements, modifiers or sinks listed in another order, have the
+// same canonical form. It is the transformed level with sorted elements whose
+// key is the smallest. Digits and emitters stay in the order given, since the
+// later of two digits on a cell is the one requirements see.
+Sim::LevelDesc CanonicalLevel(const Sim::LevelDesc& levelDesc, int* symmetry);
+// A flat list of ints that identifies a level with sorted elements. Digits
+// and emitters appear in their order.
+std::vector<int> LevelKey(const Sim::LevelDesc& levelDesc);
+uint64_t CanonicalHash(const Sim::LevelDesc& levelDesc);
+
+} // namespace Pack
+
+#endif
@@ -4,6 +4,10 @@
 #include <Input.h>
 #include <Temporal.h>
 #include <VarkorMain.h>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
 #include <comp/BoxCollider.h>
 #include <comp/Camera.h>
 #include <comp/CameraOrbiter.h>
@@ -12,31 +16,29 @@
 #include <comp/Sprite.h>
 #include <comp/Text.h>
 #include <comp/Transform.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <editor/Editor.h>
 #include <gfx/Renderer.h>
 #include <imgui/imgui.h>
 #include <math/Constants.h>
+#include <memory_resource>
+#include <new>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
 #include <world/Registrar.h>
 #include <world/World.h>
 
-// This is a cellular automata type game. There are three primary game elements.
-
-// Requirement - A requirment occupies 2 cells, both of which can be anywhere on
-// the grid. One of the cells signifies a physical digit. The other cell
-// signifies the filtered digit.
-
-// Shifter - An arrow pointing in one of four directions. When a physical digit
-// arrives at a shifter, the physical digit begins to move in the direction the
-// arrow points.
-
-// Filter - When a physical digit arrives at the cell occupied by a filter, the
-// filter changes the digit, e.g. +1, *2, -5.
-
-// The goal is to place a set of filters and shifters, such that the physical
-// digits arrive at the filtered digits with the same values.
-
-enum class Direction { Up, Right, Down, Left };
+#include "AutomataWorker.h"
+#include "Level.h"
 
 void LevelSetup(size_t levelIdx);
 bool nPaused = true;
@@ -44,12 +46,27 @@ bool nAutomataStarted = false;
 const float nStartTime = 0.9f;
 constexpr float nSpeedScale = 1.8f;
 float nAutomataTimePassed = nStartTime;
+AutomataWorker nAutomata;
+int nAutomataGeneration = 0;
+// The tick the worker gets to once it has taken every step sent for the
+// current board, and the tick of the last snapshot shown.
+int nAutomataTargetTick = 0;
+int nAutomataShownTick = 0;
 const Vec3 nFieldOrigin = {0.0f, 0.0f, 0.0f};
-constexpr int nFieldWidth = 10;
-constexpr int nFieldHeight = 10;
 World::MemberId nDigitLayer[nFieldWidth][nFieldHeight];
 World::MemberId nModifierLayer[nFieldWidth][nFieldHeight];
 World::MemberId nRequirementLayer[nFieldWidth][nFieldHeight];
+// Cells holding an emitter or a sink.
+World::MemberId nFixtureLayer[nFieldWidth][nFieldHeight];
+
+// Digits are drawn by one object per cell instead of one per digit, so any
+// number of live digits costs the same to draw. Each shows the digit on top of
+// its cell and is parked off screen while its cell is empty.
+struct CellDigit {
+  World::MemberId mMemberId;
+  bool mShown;
+};
+CellDigit nCellDigits[nFieldWidth][nFieldHeight];
 
 const float nCursorZ = -1.0f;
 const float nFieldZ = 0.0f;
@@ -63,8 +80,10 @@ const float nPlaceableScale = 1.2f;
 const float nDigitScale = 0.6f;
 
 const Vec3 nPlaceableIdsOrigin = {11.0f, 7.8f, nModifierZ};
-Ds::Vector<World::MemberId> nPlaceableIds;
+const Vec3 nHiddenPlaceableTranslation = {-100.0f, -100.0f, nModifierZ};
+const Vec3 nHiddenDigitTranslation = {-100.0f, -100.0f, nDigitZ};
 const int nPlaceableCols = 8;
+const int nPlaceableVisibleRows = 3;
 
 struct Cursor {
   World::Object mObject;
@@ -81,220 +100,363 @@ const char* nRunDisplayStartText = " =";
 World::Object nLevelDisplay;
 bool nRequirementsFulfilled = false;
 
-struct Digit {
-  int mCell[2];
-  int mValue;
-  Direction mDirection;
+int nCurrentLevel = -1;
+
+// Forwards allocations to an upstream resource while keeping count of them.
+struct AllocationCounter: std::pmr::memory_resource {
+  AllocationCounter(std::pmr::memory_resource* upstream): mUpstream(upstream) {}
+  void ResetCounts() {
+    mAllocations = 0;
+    mBytes = 0;
+    mPeakBytes = 0;
+    mTotalBytes = 0;
+  }
+
+  std::pmr::memory_resource* mUpstream;
+  size_t mAllocations = 0;
+  size_t mBytes = 0;
+  size_t mPeakBytes = 0;
+  size_t mTotalBytes = 0;
+
+private:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    void* memory = mUpstream->allocate(bytes, alignment);
+    ++mAllocations;
+    mBytes += bytes;
+    mTotalBytes += bytes;
+    mPeakBytes = std::max(mPeakBytes, mBytes);
+    return memory;
+  }
+  void do_deallocate(void* memory, size_t bytes, size_t alignment) override {
+    mUpstream->deallocate(memory, bytes, alignment);
+    mBytes -= bytes;
+  }
+  bool do_is_equal(const std::pmr::memory_resource& other) const
+    noexcept override {
+    return this == &other;
+  }
 };
-struct Requirement {
-  int mCell[2];
-  int mValue;
+
+// Backs the storage that lives exactly as long as a level, i.e. the placeable
+// inventory and the modifier ids. Their sizes are known when the level loads,
+// so they are reserved once and never grow. Nothing is freed piecemeal. The
+// whole arena is released at once when a level switch empties the level.
+struct LevelArenaStats {
+  size_t mAllocations;
+  size_t mBytes;
+  size_t mOverflowAllocations;
+  size_t mOverflowBytes;
 };
-struct Filter {
-  int mStartCell[2];
-  int mValue;
-  enum class Type { Add, Sub, Mul, Mod };
-  Type mType;
-  bool mPlaceable;
+struct LevelArena {
+  std::pmr::memory_resource* Resource() {
+    return &mCounter;
+  }
+  void RecordLoad() {
+    ++mLoads;
+    mLastLoad.mAllocations = mCounter.mAllocations;
+    mLastLoad.mBytes = mCounter.mTotalBytes;
+    mLastLoad.mOverflowAllocations = mOverflow.mAllocations;
+    mLastLoad.mOverflowBytes = mOverflow.mTotalBytes;
+    mPeakBytes = std::max(mPeakBytes, mCounter.mTotalBytes);
+  }
+  void Release() {
+    mBufferResource.release();
+    mCounter.ResetCounts();
+    mOverflow.ResetCounts();
+  }
+
+  // Allocations that don't fit in mBuffer go to the heap in large chunks.
+  alignas(std::max_align_t) std::byte mBuffer[4096];
+  AllocationCounter mOverflow {std::pmr::new_delete_resource()};
+  std::pmr::monotonic_buffer_resource mBufferResource {
+    mBuffer, sizeof(mBuffer), &mOverflow};
+  AllocationCounter mCounter {&mBufferResource};
+  size_t mLoads = 0;
+  size_t mPeakBytes = 0;
+  LevelArenaStats mLastLoad = {};
 };
-struct Shifter {
-  int mStartCell[2];
-  Direction mDirection;
-  bool mPlaceable;
+LevelArena nLevelArena;
+
+// Hands a container's storage back to its arena. Assigning a new container
+// wouldn't, since pmr containers keep their own resource on assignment.
+template<typename T>
+void ReleaseStorage(std::pmr::vector<T>& vector) {
+  std::pmr::vector<T>(vector.get_allocator()).swap(vector);
+}
+
+// Modifiers in the order of Sim::Board's modifier ids, so the worker's
+// indices map back to members.
+std::pmr::vector<MemberId> nModifierIds(nLevelArena.Resource());
+
+// Labels are put together on the stack. Text components copy them into
+// strings the engine owns, so those can't come from the arena. Whatever
+// doesn't fit is cut off.
+struct Label {
+  Label& Append(std::string_view string) {
+    size_t count = std::min(string.size(), sizeof(mText) - 1 - mSize);
+    std::memcpy(mText + mSize, string.data(), count);
+    mSize += count;
+    mText[mSize] = '\0';
+    return *this;
+  }
+  Label& Append(int value) {
+    std::to_chars_result result =
+      std::to_chars(mText + mSize, mText + sizeof(mText) - 1, value);
+    if (result.ec == std::errc()) {
+      mSize = result.ptr - mText;
+    }
+    mText[mSize] = '\0';
+    return *this;
+  }
+
+  char mText[64] = {};
+  size_t mSize = 0;
 };
 
-struct Level {
-  std::string mName;
-  Ds::Vector<Digit> mDigits;
-  Ds::Vector<Requirement> mRequirements;
-  Ds::Vector<Filter> mFilters;
-  Ds::Vector<Shifter> mShifters;
+// Every heap allocation is charged to the subsystem that made it, so memory
+// can be broken down by what a level loads. The frame thread picks the tag
+// with a MemoryScope and the automata worker tags its whole thread.
+enum class MemoryTag {
+  Engine,
+  FieldSetup,
+  LevelSetup,
+  LockingSprites,
+  Text,
+  Placeables,
+  Automata,
+  Count,
 };
-Ds::Vector<Level> nLevels;
-int nCurrentLevel = -1;
-void CreateLevels() {
-  {
-    Level level;
-    level.mName = "Need Some Space";
-    level.mDigits = {
-      {{5, 3}, 2, Direction::Up},
-    };
-    level.mRequirements = {
-      {{5, 7}, 4},
-    };
-    level.mFilters = {
-      {{5, 5}, 2, Filter::Type::Add, false},
-    };
-    level.mShifters = {};
-    nLevels.Emplace(std::move(level));
-  }
-
-  {
-    Level level;
-    level.mName = "Operation Order";
-    level.mDigits = {
-      {{2, 5}, 1, Direction::Right},
-    };
-    level.mRequirements = {
-      {{8, 5}, 9},
-    };
-    level.mFilters = {
-      {{5, 5}, 3, Filter::Type::Mul, false},
-      {{5, 5}, 6, Filter::Type::Add, true},
-    };
-    level.mShifters = {};
-    nLevels.Emplace(std::move(level));
-  }
-
-  {
-    Level level;
-    level.mName = "Get Shifty";
-    level.mDigits = {
-      {{3, 8}, 3, Direction::Down},
-    };
-    level.mRequirements = {
-      {{6, 3}, 9},
-    };
-    level.mFilters = {
-      {{5, 3}, 3, Filter::Type::Mul, false},
-    };
-    level.mShifters = {
-      {{-1, -1}, Direction::Right, true},
-    };
-    nLevels.Emplace(std::move(level));
-  }
-
-  {
-    Level level;
-    level.mName = "Get Back";
-    level.mDigits = {
-      {{7, 6}, 0, Direction::Left},
-    };
-    level.mRequirements = {
-      {{5, 6}, 8},
-    };
-    level.mFilters = {
-      {{-1, -1}, 4, Filter::Type::Add, true},
-    };
-    level.mShifters = {
-      {{-1, -1}, Direction::Right, true},
-    };
-    nLevels.Emplace(std::move(level));
-  }
-
-  {
-    Level level;
-    level.mName = "ABC...";
-    level.mDigits = {
-      {{6, 4}, 1, Direction::Up},
-    };
-    level.mRequirements = {
-      {{6, 6}, 7},
-    };
-    level.mFilters = {
-      {{-1, -1}, 1, Filter::Type::Add, true},
-    };
-    level.mShifters = {
-      {{6, 7}, Direction::Down, false},
-      {{-1, -1}, Direction::Up, true},
-    };
-    nLevels.Emplace(std::move(level));
-  }
-
-  {
-    Level level;
-    level.mName = "Poor Timing?";
-    level.mDigits = {
-      {{3, 7}, 6, Direction::Right},
-      {{6, 7}, 6, Direction::Left},
-    };
-    level.mRequirements = {
-      {{2, 1}, 6},
-      {{7, 5}, 6},
-    };
-    level.mFilters = {};
-    level.mShifters = {
-      {{2, 7}, Direction::Down, false},
-      {{-1, -1}, Direction::Down, true},
-      {{-1, -1}, Direction::Up, true},
-    };
-    nLevels.Emplace(std::move(level));
-  }
-
-  {
-    Level level;
-    level.mName = "Together We Stand";
-    level.mDigits = {
-      {{2, 7}, 8, Direction::Down},
-      {{7, 2}, 8, Direction::Up},
-    };
-    level.mRequirements = {
-      {{9, 3}, 0},
-      {{1, 7}, 0},
-    };
-    level.mFilters = {
-      {{-1, -1}, 8, Filter::Type::Sub, true},
-    };
-    level.mShifters = {
-      {{-1, -1}, Direction::Left, true},
-      {{-1, -1}, Direction::Right, true},
-    };
-    nLevels.Emplace(std::move(level));
-  }
-
-  {
-    Level level;
-    level.mName = "Stay In Line";
-    level.mDigits = {
-      {{2, 2}, 4, Direction::Right},
-      {{7, 2}, 5, Direction::Left},
-    };
-    level.mRequirements = {
-      {{4, 7}, 8},
-      {{4, 6}, 4},
-    };
-    level.mFilters = {
-      {{4, 5}, 2, Filter::Type::Mul, false},
-      {{-1, -1}, 3, Filter::Type::Sub, true},
-    };
-    level.mShifters = {
-      {{-1, -1}, Direction::Up, true},
-    };
-    nLevels.Emplace(std::move(level));
-  }
-
-  {
-    Level level;
-    level.mName = "Off By One";
-    level.mDigits = {
-      {{5, 3}, 0, Direction::Up},
-      {{6, 5}, 0, Direction::Left},
-      {{4, 6}, 0, Direction::Down},
-      {{3, 4}, 0, Direction::Right},
-    };
-    level.mRequirements = {
-      {{4, 3}, 4},
-      {{6, 4}, 4},
-      {{5, 6}, 5},
-      {{3, 5}, 5},
-    };
-    level.mFilters = {
-      {{5, 4}, 1, Filter::Type::Add, false},
-      {{5, 5}, 1, Filter::Type::Add, false},
-      {{-1, -1}, 1, Filter::Type::Add, true},
-    };
-    level.mShifters = {
-      {{4, 2}, Direction::Right, false},
-      {{5, 2}, Direction::Up, false},
-      {{5, 7}, Direction::Left, false},
-      {{4, 7}, Direction::Down, false},
-      {{2, 5}, Direction::Down, false},
-      {{2, 4}, Direction::Right, false},
-      {{7, 4}, Direction::Up, false},
-      {{7, 5}, Direction::Left, false},
-    };
-    nLevels.Emplace(std::move(level));
+constexpr int nMemoryTagCount = (int)MemoryTag::Count;
+constexpr const char* nMemoryTagNames[nMemoryTagCount] = {
+  "Engine",
+  "Field Setup",
+  "Level Setup",
+  "Locking Sprites",
+  "Text",
+  "Placeables",
+  "Automata",
+};
+
+// Blocks are often freed on another thread than the one that allocated them,
+// e.g. automata commands, so the counts are atomic.
+struct TagCounter {
+  void Allocate(size_t bytes) {
+    mAllocations.fetch_add(1, std::memory_order_relaxed);
+    mTotalAllocations.fetch_add(1, std::memory_order_relaxed);
+    size_t current = mBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t peak = mPeakBytes.load(std::memory_order_relaxed);
+    while (
+      peak < current &&
+      !mPeakBytes.compare_exchange_weak(
+        peak, current, std::memory_order_relaxed)) {
+    }
+  }
+  void Deallocate(size_t bytes) {
+    mAllocations.fetch_sub(1, std::memory_order_relaxed);
+    mBytes.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+
+  // Live allocations and bytes.
+  std::atomic<size_t> mAllocations = 0;
+  std::atomic<size_t> mBytes = 0;
+  std::atomic<size_t> mPeakBytes = 0;
+  std::atomic<size_t> mTotalAllocations = 0;
+};
+TagCounter nTagCounters[nMemoryTagCount];
+thread_local MemoryTag nMemoryTag = MemoryTag::Engine;
+
+struct MemoryScope {
+  MemoryScope(MemoryTag tag): mPrevTag(nMemoryTag) {
+    nMemoryTag = tag;
+  }
+  ~MemoryScope() {
+    nMemoryTag = mPrevTag;
+  }
+  MemoryTag mPrevTag;
+};
+
+void TagAutomataThread() {
+  nMemoryTag = MemoryTag::Automata;
+}
+
+// Sits right before every block operator new hands out.
+struct AllocationHeader {
+  void* mBlock;
+  size_t mBytes;
+  MemoryTag mTag;
+};
+
+void* TaggedAllocate(size_t bytes, size_t alignment) {
+  alignment = std::max(alignment, alignof(std::max_align_t));
+  size_t padding = sizeof(AllocationHeader) + alignment - 1;
+  if (bytes > SIZE_MAX - padding) {
+    throw std::bad_alloc();
+  }
+  // Give the installed new handler a chance to free memory before failing,
+  // as the global operator new would.
+  void* block;
+  while ((block = std::malloc(bytes + padding)) == nullptr) {
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+  uintptr_t address = (uintptr_t)block + sizeof(AllocationHeader);
+  address = (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+  void* memory = (void*)address;
+  AllocationHeader* header = (AllocationHeader*)memory - 1;
+  header->mBlock = block;
+  header->mBytes = bytes;
+  header->mTag = nMemoryTag;
+  nTagCounters[(int)header->mTag].Allocate(bytes);
+  return memory;
+}
+
+void TaggedDeallocate(void* memory) {
+  if (memory == nullptr) {
+    return;
+  }
+  AllocationHeader* header = (AllocationHeader*)memory - 1;
+  nTagCounters[(int)header->mTag].Deallocate(header->mBytes);
+  std::free(header->mBlock);
+}
+
+// The array and nothrow forms forward to these by default.
+void* operator new(size_t bytes) {
+  return TaggedAllocate(bytes, alignof(std::max_align_t));
+}
+void* operator new(size_t bytes, std::align_val_t alignment) {
+  return TaggedAllocate(bytes, (size_t)alignment);
+}
+void operator delete(void* memory) noexcept {
+  TaggedDeallocate(memory);
+}
+void operator delete(void* memory, size_t) noexcept {
+  TaggedDeallocate(memory);
+}
+void operator delete(void* memory, std::align_val_t) noexcept {
+  TaggedDeallocate(memory);
+}
+void operator delete(void* memory, size_t, std::align_val_t) noexcept {
+  TaggedDeallocate(memory);
+}
+
+// The live bytes of every tag when the last two levels finished loading.
+// Resetting a level should leave them unchanged, so a tag that keeps growing
+// across reloads is leaking.
+size_t nLoadBytes[nMemoryTagCount] = {};
+size_t nPrevLoadBytes[nMemoryTagCount] = {};
+
+void RecordLoadMemory() {
+  for (int i = 0; i < nMemoryTagCount; ++i) {
+    nPrevLoadBytes[i] = nLoadBytes[i];
+    nLoadBytes[i] = nTagCounters[i].mBytes.load(std::memory_order_relaxed);
+  }
+}
+
+// The built-in levels are constant tables, so they never touch the heap.
+size_t LevelDataBytes() {
+  size_t bytes = sizeof(nLevels);
+  for (const Level& level: nLevels) {
+    bytes += level.mName.size() + level.mDigits.size_bytes() +
+      level.mRequirements.size_bytes() + level.mFilters.size_bytes() +
+      level.mShifters.size_bytes() + level.mEmitters.size_bytes() +
+      level.mSinks.size_bytes();
+  }
+  return bytes;
+}
+
+// Prints the breakdown for runs without the debug panel.
+void DumpMemory() {
+  std::printf(
+    "%-16s %12s %12s %10s %12s\n",
+    "Memory",
+    "Bytes",
+    "Peak Bytes",
+    "Live",
+    "Allocations");
+  for (int i = 0; i < nMemoryTagCount; ++i) {
+    const TagCounter& counter = nTagCounters[i];
+    std::printf(
+      "%-16s %12zu %12zu %10zu %12zu\n",
+      nMemoryTagNames[i],
+      counter.mBytes.load(std::memory_order_relaxed),
+      counter.mPeakBytes.load(std::memory_order_relaxed),
+      counter.mAllocations.load(std::memory_order_relaxed),
+      counter.mTotalAllocations.load(std::memory_order_relaxed));
+  }
+  std::printf("%-16s %12zu\n", "Level Data", LevelDataBytes());
+}
+
+// Text components own a copy of their string.
+void SetText(Comp::Text& text, const char* string) {
+  MemoryScope scope(MemoryTag::Text);
+  text.mText = string;
+}
+
+bool nShowDebugPanel = false;
+void DebugPanel() {
+  ImGui::Begin("Debug", &nShowDebugPanel);
+  ImGui::Text("Level Arena");
+  ImGui::Separator();
+  ImGui::Text("Loads: %zu", nLevelArena.mLoads);
+  ImGui::Text("Peak Bytes: %zu", nLevelArena.mPeakBytes);
+  const LevelArenaStats& lastLoad = nLevelArena.mLastLoad;
+  ImGui::Text("Last Load Allocations: %zu", lastLoad.mAllocations);
+  ImGui::Text("Last Load Bytes: %zu", lastLoad.mBytes);
+  ImGui::Text(
+    "Last Load Heap Chunks: %zu (%zu bytes)",
+    lastLoad.mOverflowAllocations,
+    lastLoad.mOverflowBytes);
+
+  ImGui::Text("Memory");
+  ImGui::Separator();
+  ImGui::Text(
+    "%-16s %10s %10s %8s %12s", "Tag", "Bytes", "Peak", "Live", "Load Change");
+  for (int i = 0; i < nMemoryTagCount; ++i) {
+    const TagCounter& counter = nTagCounters[i];
+    ImGui::Text(
+      "%-16s %10zu %10zu %8zu %+12lld",
+      nMemoryTagNames[i],
+      counter.mBytes.load(std::memory_order_relaxed),
+      counter.mPeakBytes.load(std::memory_order_relaxed),
+      counter.mAllocations.load(std::memory_order_relaxed),
+      (long long)nLoadBytes[i] - (long long)nPrevLoadBytes[i]);
+  }
+  ImGui::Text("Level Data (static): %zu bytes", LevelDataBytes());
+  ImGui::End();
+}
+
+// Replaces the player with a script of key presses. Every frame of a playback
+// sees the same time step, so a script always runs the same way and the frame
+// times of two builds can be compared.
+constexpr float nPlaybackDeltaTime = 1.0f / 60.0f;
+struct Playback {
+  bool mActive = false;
+  // The keys pressed on every frame.
+  std::vector<std::vector<Input::Key>> mFrames;
+  size_t mFrame = 0;
+  // The worker's time for every step shown.
+  std::vector<double> mStepTimes;
+};
+Playback nPlayback;
+
+// Gameplay reads keys and time through these so a playback can stand in for
+// the player.
+bool FrameKeyPressed(Input::Key key) {
+  if (!nPlayback.mActive) {
+    return Input::KeyPressed(key);
   }
+  const std::vector<Input::Key>& keys = nPlayback.mFrames[nPlayback.mFrame];
+  return std::find(keys.begin(), keys.end(), key) != keys.end();
+}
+
+float FrameDeltaTime() {
+  if (!nPlayback.mActive) {
+    return Temporal::DeltaTime();
+  }
+  return nPlaybackDeltaTime;
 }
 
 void InitializeLayers(bool resetModifiers) {
@@ -305,6 +467,7 @@ void InitializeLayers(bool resetModifiers) {
         nModifierLayer[j][i] = World::nInvalidMemberId;
       }
       nRequirementLayer[j][i] = World::nInvalidMemberId;
+      nFixtureLayer[j][i] = World::nInvalidMemberId;
     }
   }
 }
@@ -338,108 +501,256 @@ void UpdateDigitArrowGraphic(World::MemberId digitMemberId) {
   }
 }
 
-void UpdatePlaceableGraphics() {
+void ShowCellDigit(int x, int y, const AutomataCell& cell) {
+  CellDigit& cellDigit = nCellDigits[x][y];
   World::Space& space = World::nLayers.Back()->mSpace;
-  for (size_t i = 0; i < nPlaceableIds.Size(); ++i) {
-    auto& transform = space.Get<Comp::Transform>(nPlaceableIds[i]);
-    Vec3 offset = {
-      (float)(i % nPlaceableCols), -(float)(i / nPlaceableCols), nModifierZ};
-    transform.SetTranslation(nPlaceableIdsOrigin + offset);
+  auto& transform = space.Get<Comp::Transform>(cellDigit.mMemberId);
+  if (!cell.mOccupied) {
+    if (cellDigit.mShown) {
+      transform.SetTranslation(nHiddenDigitTranslation);
+      cellDigit.mShown = false;
+    }
+    return;
   }
-}
-
-void UpdateGraphics() {
-  World::Space& space = World::nLayers.Back()->mSpace;
-  Ds::Vector<MemberId> digitIds = space.Slice<Digit>();
-  for (MemberId memberId: digitIds) {
-    const auto& digit = space.Get<Digit>(memberId);
-    auto& transform = space.Get<Comp::Transform>(memberId);
-    Vec3 offset = {(float)digit.mCell[0], (float)digit.mCell[1], nDigitZ};
+  if (!cellDigit.mShown) {
+    Vec3 offset = {(float)x, (float)y, nDigitZ};
     transform.SetTranslation(nFieldOrigin + offset);
+    cellDigit.mShown = true;
+  }
 
-    const auto& relationship = space.Get<Comp::Relationship>(memberId);
+  // The text and arrow only change when the shown digit does.
+  auto& digit = space.Get<Digit>(cellDigit.mMemberId);
+  bool turned = digit.mDirection != cell.mDirection;
+  bool changed = digit.mValue != cell.mValue;
+  digit.mValue = cell.mValue;
+  digit.mDirection = cell.mDirection;
+  if (turned) {
+    UpdateDigitArrowGraphic(cellDigit.mMemberId);
+  }
+  if (changed) {
+    const auto& relationship =
+      space.Get<Comp::Relationship>(cellDigit.mMemberId);
     auto& text = space.Get<Comp::Text>(relationship.mChildren[0]);
-    text.mText = std::to_string(digit.mValue);
+    SetText(text, Label().Append(digit.mValue).mText);
+  }
+}
+
+void HideCellDigits() {
+  for (int x = 0; x < nFieldWidth; ++x) {
+    for (int y = 0; y < nFieldHeight; ++y) {
+      ShowCellDigit(x, y, {false, 0, Direction::Up});
+    }
   }
 }
 
-void PerformStep() {
+// Placeables live in slots that never move while a level is loaded. Every
+// kind of placeable, i.e. each filter type and shifter direction, owns a
+// contiguous run of slots. Taking a placeable pushes its slot onto the group's
+// free list and stocking one fills a free slot of its group, so both are
+// constant time. Only rows in view are positioned. The rest are parked off
+// screen.
+constexpr int nFilterTypeCount = 4;
+constexpr int nPlaceableGroupCount = nFilterTypeCount + 4;
+struct PlaceableGroup {
+  int mFirstSlot;
+  int mSlotCount;
+  std::pmr::vector<int> mFreeSlots {nLevelArena.Resource()};
+};
+struct PlaceableInventory {
+  std::pmr::vector<World::MemberId> mSlots {nLevelArena.Resource()};
+  PlaceableGroup mGroups[nPlaceableGroupCount];
+  int mScrollRow;
+};
+PlaceableInventory nPlaceables;
+
+int PlaceableGroupIndex(const Filter& filter) {
+  return (int)filter.mType;
+}
+
+int PlaceableGroupIndex(const Shifter& shifter) {
+  return nFilterTypeCount + (int)shifter.mDirection;
+}
+
+int PlaceableGroupIndex(World::MemberId placeableId) {
   World::Space& space = World::nLayers.Back()->mSpace;
-  Ds::Vector<MemberId> digitIds = space.Slice<Digit>();
-  for (MemberId memberId: digitIds) {
-    // Update the digits position
-    auto& digit = space.Get<Digit>(memberId);
-    nDigitLayer[digit.mCell[0]][digit.mCell[1]] = World::nInvalidMemberId;
-    switch (digit.mDirection) {
-    case Direction::Up: digit.mCell[1] += 1; break;
-    case Direction::Right: digit.mCell[0] += 1; break;
-    case Direction::Down: digit.mCell[1] -= 1; break;
-    case Direction::Left: digit.mCell[0] -= 1; break;
-    }
-    digit.mCell[0] = Math::Clamp(0, 9, digit.mCell[0]);
-    digit.mCell[1] = Math::Clamp(0, 9, digit.mCell[1]);
-    nDigitLayer[digit.mCell[0]][digit.mCell[1]] = memberId;
-
-    World::MemberId modifierMemberId =
-      nModifierLayer[digit.mCell[0]][digit.mCell[1]];
-    if (modifierMemberId == World::nInvalidMemberId) {
-      continue;
+  auto* filter = space.TryGet<Filter>(placeableId);
+  if (filter != nullptr) {
+    return PlaceableGroupIndex(*filter);
+  }
+  return PlaceableGroupIndex(space.Get<Shifter>(placeableId));
+}
+
+int PlaceableSlotCount() {
+  return (int)nPlaceables.mSlots.size();
+}
+
+void PositionPlaceableSlot(int slot) {
+  World::MemberId placeableId = nPlaceables.mSlots[slot];
+  if (placeableId == World::nInvalidMemberId) {
+    return;
+  }
+  World::Space& space = World::nLayers.Back()->mSpace;
+  auto& transform = space.Get<Comp::Transform>(placeableId);
+  int row = slot / nPlaceableCols - nPlaceables.mScrollRow;
+  if (row < 0 || row >= nPlaceableVisibleRows) {
+    transform.SetTranslation(nHiddenPlaceableTranslation);
+    return;
+  }
+  Vec3 offset = {(float)(slot % nPlaceableCols), -(float)row, nModifierZ};
+  transform.SetTranslation(nPlaceableIdsOrigin + offset);
+}
+
+void PositionPlaceableRows(int firstRow, int rowCount) {
+  int endSlot =
+    std::min(PlaceableSlotCount(), (firstRow + rowCount) * nPlaceableCols);
+  for (int slot = firstRow * nPlaceableCols; slot < endSlot; ++slot) {
+    PositionPlaceableSlot(slot);
+  }
+}
+
+void ScrollPlaceables(int scrollRow) {
+  int prevScrollRow = nPlaceables.mScrollRow;
+  if (scrollRow == prevScrollRow) {
+    return;
+  }
+  // Park the rows that left the view and lay out the rows now in view.
+  nPlaceables.mScrollRow = scrollRow;
+  PositionPlaceableRows(prevScrollRow, nPlaceableVisibleRows);
+  PositionPlaceableRows(scrollRow, nPlaceableVisibleRows);
+}
+
+void ResetPlaceables(const Level& level) {
+  MemoryScope scope(MemoryTag::Placeables);
+  int groupSlotCounts[nPlaceableGroupCount] = {};
+  for (const Filter& filter: level.mFilters) {
+    if (filter.mPlaceable) {
+      ++groupSlotCounts[PlaceableGroupIndex(filter)];
     }
-    World::Object modifierObj(&space, modifierMemberId);
-    auto* shifter = modifierObj.TryGet<Shifter>();
-    if (shifter != nullptr) {
-      digit.mDirection = shifter->mDirection;
-      UpdateDigitArrowGraphic(memberId);
-    }
-    auto* filter = modifierObj.TryGet<Filter>();
-    if (filter != nullptr) {
-      switch (filter->mType) {
-      case Filter::Type::Add:
-        digit.mValue = digit.mValue + filter->mValue;
-        break;
-      case Filter::Type::Sub:
-        digit.mValue = digit.mValue - filter->mValue;
-        break;
-      case Filter::Type::Mul:
-        digit.mValue = digit.mValue * filter->mValue;
-        break;
-      case Filter::Type::Mod:
-        digit.mValue = digit.mValue % filter->mValue;
-        break;
-      }
-      digit.mValue = (digit.mValue + 10) % 10;
+  }
+  for (const Shifter& shifter: level.mShifters) {
+    if (shifter.mPlaceable) {
+      ++groupSlotCounts[PlaceableGroupIndex(shifter)];
+    }
+  }
+
+  // The free lists are filled back to front so a group fills its slots in
+  // order. A free list never holds more than its group's slots.
+  int slotCount = 0;
+  for (int i = 0; i < nPlaceableGroupCount; ++i) {
+    PlaceableGroup& group = nPlaceables.mGroups[i];
+    group.mFirstSlot = slotCount;
+    group.mSlotCount = groupSlotCounts[i];
+    group.mFreeSlots.clear();
+    group.mFreeSlots.reserve(group.mSlotCount);
+    for (int j = group.mSlotCount - 1; j >= 0; --j) {
+      group.mFreeSlots.push_back(group.mFirstSlot + j);
     }
+    slotCount += group.mSlotCount;
   }
+  nPlaceables.mSlots.assign(slotCount, World::nInvalidMemberId);
+  nPlaceables.mScrollRow = 0;
 }
 
-void CheckRequirements() {
-  World::Space& space = World::nLayers.Back()->mSpace;
-  Ds::Vector<World::MemberId> requirementIds = space.Slice<Requirement>();
-  for (World::MemberId requirementId: requirementIds) {
-    const auto& req = space.Get<Requirement>(requirementId);
-    World::MemberId digitIdAtReq = nDigitLayer[req.mCell[0]][req.mCell[1]];
-    if (digitIdAtReq == World::nInvalidMemberId) {
-      return;
+void StockPlaceable(World::MemberId placeableId) {
+  PlaceableGroup& group = nPlaceables.mGroups[PlaceableGroupIndex(placeableId)];
+  int slot = group.mFreeSlots.back();
+  group.mFreeSlots.pop_back();
+  nPlaceables.mSlots[slot] = placeableId;
+  PositionPlaceableSlot(slot);
+}
+
+World::MemberId TakePlaceable(int slot) {
+  MemoryScope scope(MemoryTag::Placeables);
+  World::MemberId placeableId = nPlaceables.mSlots[slot];
+  nPlaceables.mSlots[slot] = World::nInvalidMemberId;
+  nPlaceables.mGroups[PlaceableGroupIndex(placeableId)].mFreeSlots.push_back(
+    slot);
+  return placeableId;
+}
+
+int CursorPlaceableSlot() {
+  return nCursor.mPlaceableCell[0] +
+    nCursor.mPlaceableCell[1] * nPlaceableCols;
+}
+
+void UpdateGraphics() {
+  const AutomataSnapshot* snapshot = nAutomata.Consume();
+  if (snapshot == nullptr || snapshot->mGeneration != nAutomataGeneration) {
+    return;
+  }
+  if (nPlayback.mActive && snapshot->mTick > nAutomataShownTick) {
+    nPlayback.mStepTimes.push_back(snapshot->mStepMicroseconds);
+  }
+  nAutomataShownTick = snapshot->mTick;
+  for (int x = 0; x < nFieldWidth; ++x) {
+    for (int y = 0; y < nFieldHeight; ++y) {
+      ShowCellDigit(x, y, snapshot->mCells[y * nFieldWidth + x]);
     }
-    const auto& digit = space.Get<Digit>(digitIdAtReq);
-    if (digit.mValue != req.mValue) {
-      return;
+  }
+
+  if (snapshot->mRequirementsMet) {
+    nRunDisplay.Get<Comp::Text>().mText = "==";
+    nPaused = true;
+    nRequirementsFulfilled = true;
+  }
+}
+
+// Hands the board as placed to the worker. Modifiers are sent as the index of
+// their member in nModifierIds.
+void LoadAutomata() {
+  MemoryScope scope(MemoryTag::Automata);
+  AutomataCommand command = {};
+  command.mType = AutomataCommand::Type::Load;
+  command.mGeneration = nAutomataGeneration;
+  nAutomataTargetTick = 0;
+  nAutomataShownTick = 0;
+  command.mLevel = Sim::MakeLevelDesc(nLevels[nCurrentLevel]);
+  command.mModifiers.assign(nFieldWidth * nFieldHeight, Sim::nNoModifier);
+  for (int x = 0; x < nFieldWidth; ++x) {
+    for (int y = 0; y < nFieldHeight; ++y) {
+      MemberId modifierId = nModifierLayer[x][y];
+      if (modifierId == World::nInvalidMemberId) {
+        continue;
+      }
+      for (int i = 0; i < (int)nModifierIds.size(); ++i) {
+        if (nModifierIds[i] == modifierId) {
+          command.mModifiers[y * nFieldWidth + x] = i;
+        }
+      }
     }
   }
+  nAutomata.Send(std::move(command));
+}
 
-  nRunDisplay.Get<Comp::Text>().mText = "==";
-  nPaused = true;
-  nRequirementsFulfilled = true;
+void SendAutomataCommand(AutomataCommand::Type type, int steps = 0) {
+  MemoryScope scope(MemoryTag::Automata);
+  AutomataCommand command = {};
+  command.mType = type;
+  command.mGeneration = nAutomataGeneration;
+  command.mSteps = steps;
+  nAutomata.Send(std::move(command));
 }
 
 void RunAutomata() {
   int prevTimePassedFloor = (int)nAutomataTimePassed;
-  nAutomataTimePassed += nSpeedScale * Temporal::DeltaTime();
+  nAutomataTimePassed += nSpeedScale * FrameDeltaTime();
   int currTimePassedFloor = (int)nAutomataTimePassed;
   if (prevTimePassedFloor != currTimePassedFloor) {
-    PerformStep();
+    SendAutomataCommand(AutomataCommand::Type::Step, 1);
+    ++nAutomataTargetTick;
+  }
+}
+
+// A playback frame isn't over until the worker has shown every step sent to
+// it. Otherwise how far a run gets would depend on how fast the worker is, and
+// with it which phase each later frame falls in.
+void WaitForAutomata() {
+  while (
+    nAutomataStarted && !nRequirementsFulfilled &&
+    nAutomataShownTick < nAutomataTargetTick) {
+    std::this_thread::yield();
+    nAutomata.Flush();
     UpdateGraphics();
-    CheckRequirements();
   }
 }
 
@@ -451,6 +762,13 @@ void TryPlaceModifier() {
     return;
   }
 
+  // Can't place on emitters or sinks.
+  bool fixtureExists = nFixtureLayer[nCursor.mCell[0]][nCursor.mCell[1]] !=
+    World::nInvalidMemberId;
+  if (fixtureExists) {
+    return;
+  }
+
   // Can't place modifiers on modifiers aren't placeable.
   World::Space& space = World::nLayers.Back()->mSpace;
   World::MemberId modifierIdUnderCursor =
@@ -464,7 +782,7 @@ void TryPlaceModifier() {
     if (shifter != nullptr && !shifter->mPlaceable) {
       return;
     }
-    nPlaceableIds.Push(modifierIdUnderCursor);
+    StockPlaceable(modifierIdUnderCursor);
     nModifierLayer[nCursor.mCell[0]][nCursor.mCell[1]] =
       World::nInvalidMemberId;
   }
@@ -477,10 +795,7 @@ void TryPlaceModifier() {
   }
 
   if (nCursor.mPlaceableSelected) {
-    size_t placeableIndex =
-      nCursor.mPlaceableCell[0] + (nCursor.mPlaceableCell[1] * 6);
-    World::MemberId placeableId = nPlaceableIds[placeableIndex];
-    nPlaceableIds.Remove(placeableIndex);
+    World::MemberId placeableId = TakePlaceable(CursorPlaceableSlot());
     auto& placeableTransform = space.Get<Comp::Transform>(placeableId);
     Vec3 offset = {
       (float)nCursor.mCell[0], (float)nCursor.mCell[1], nModifierZ};
@@ -489,11 +804,10 @@ void TryPlaceModifier() {
     nCursor.mPlaceableSelected = false;
     nCursor.mSelectedObject.Get<Comp::Sprite>().mVisible = false;
   }
-  UpdatePlaceableGraphics();
 }
 
 void RunPlaceMode() {
-  if (Input::KeyPressed(Input::Key::S)) {
+  if (FrameKeyPressed(Input::Key::S)) {
     nCursor.mInField = !nCursor.mInField;
     nCursor.mPlaceableSelected = false;
     nCursor.mSelectedObject.Get<Comp::Sprite>().mVisible = false;
@@ -501,17 +815,24 @@ void RunPlaceMode() {
 
   // Handle placement and removal of field modifiers
   World::Space& space = World::nLayers.Back()->mSpace;
-  if (Input::KeyPressed(Input::Key::D)) {
+  if (FrameKeyPressed(Input::Key::D)) {
     if (!nCursor.mInField) {
-      nCursor.mInField = true;
-      nCursor.mPlaceableSelected = true;
-      Vec3 offset = {
-        (float)nCursor.mPlaceableCell[0],
-        -(float)nCursor.mPlaceableCell[1],
-        nCursorZ};
-      auto& selectedTransform = nCursor.mSelectedObject.Get<Comp::Transform>();
-      selectedTransform.SetTranslation(nPlaceableIdsOrigin + offset);
-      nCursor.mSelectedObject.Get<Comp::Sprite>().mVisible = true;
+      // Empty slots can't be selected.
+      int slot = CursorPlaceableSlot();
+      if (
+        slot < PlaceableSlotCount() &&
+        nPlaceables.mSlots[slot] != World::nInvalidMemberId) {
+        nCursor.mInField = true;
+        nCursor.mPlaceableSelected = true;
+        Vec3 offset = {
+          (float)nCursor.mPlaceableCell[0],
+          -(float)(nCursor.mPlaceableCell[1] - nPlaceables.mScrollRow),
+          nCursorZ};
+        auto& selectedTransform =
+          nCursor.mSelectedObject.Get<Comp::Transform>();
+        selectedTransform.SetTranslation(nPlaceableIdsOrigin + offset);
+        nCursor.mSelectedObject.Get<Comp::Sprite>().mVisible = true;
+      }
     }
     else {
       TryPlaceModifier();
@@ -520,16 +841,16 @@ void RunPlaceMode() {
 
   // Handle cursor movement.
   int direction[2] = {0, 0};
-  if (Input::KeyPressed(Input::Key::Up)) {
+  if (FrameKeyPressed(Input::Key::Up)) {
     direction[1] = 1;
   }
-  if (Input::KeyPressed(Input::Key::Right)) {
+  if (FrameKeyPressed(Input::Key::Right)) {
     direction[0] = 1;
   }
-  if (Input::KeyPressed(Input::Key::Down)) {
+  if (FrameKeyPressed(Input::Key::Down)) {
     direction[1] = -1;
   }
-  if (Input::KeyPressed(Input::Key::Left)) {
+  if (FrameKeyPressed(Input::Key::Left)) {
     direction[0] = -1;
   }
 
@@ -537,12 +858,12 @@ void RunPlaceMode() {
     nCursor.mCell[0] = (nCursor.mCell[0] + direction[0] + 10) % 10;
     nCursor.mCell[1] = (nCursor.mCell[1] + direction[1] + 10) % 10;
   }
-  else {
+  else if (PlaceableSlotCount() > 0) {
     nCursor.mPlaceableCell[0] += direction[0];
     nCursor.mPlaceableCell[1] += direction[1];
     // Handle column wrapping
-    int lastCol = (nPlaceableIds.Size() - 1) % nPlaceableCols;
-    int lastRow = (nPlaceableIds.Size() - 1) / nPlaceableCols;
+    int lastCol = (PlaceableSlotCount() - 1) % nPlaceableCols;
+    int lastRow = (PlaceableSlotCount() - 1) / nPlaceableCols;
     if (nCursor.mPlaceableCell[1] == lastRow) {
       nCursor.mPlaceableCell[0] =
         (nCursor.mPlaceableCell[0] + (lastCol + 1)) % (lastCol + 1);
@@ -560,6 +881,17 @@ void RunPlaceMode() {
       nCursor.mPlaceableCell[1] =
         (nCursor.mPlaceableCell[1] + lastRow) % lastRow;
     }
+
+    // Scroll just enough to keep the cursor's row in view.
+    int row = nCursor.mPlaceableCell[1];
+    int scrollRow = nPlaceables.mScrollRow;
+    if (row < scrollRow) {
+      scrollRow = row;
+    }
+    else if (row >= scrollRow + nPlaceableVisibleRows) {
+      scrollRow = row - nPlaceableVisibleRows + 1;
+    }
+    ScrollPlaceables(scrollRow);
   }
 
   auto& cursorTransform = nCursor.mObject.Get<Comp::Transform>();
@@ -570,7 +902,7 @@ void RunPlaceMode() {
   else {
     Vec3 offset = {
       (float)nCursor.mPlaceableCell[0],
-      -(float)nCursor.mPlaceableCell[1],
+      -(float)(nCursor.mPlaceableCell[1] - nPlaceables.mScrollRow),
       nCursorZ};
     cursorTransform.SetTranslation(nPlaceableIdsOrigin + offset);
   }
@@ -578,14 +910,17 @@ void RunPlaceMode() {
 
 void CentralUpdate() {
   int newLevel = nCurrentLevel;
-  if (Input::KeyPressed(Input::Key::N)) {
-    newLevel = Math::Clamp(0, (int)nLevels.Size() - 1, nCurrentLevel + 1);
+  if (FrameKeyPressed(Input::Key::N)) {
+    newLevel = Math::Clamp(0, nLevelCount - 1, nCurrentLevel + 1);
   }
-  if (Input::KeyPressed(Input::Key::B)) {
-    newLevel = Math::Clamp(0, (int)nLevels.Size() - 1, nCurrentLevel - 1);
+  if (FrameKeyPressed(Input::Key::B)) {
+    newLevel = Math::Clamp(0, nLevelCount - 1, nCurrentLevel - 1);
   }
 
-  if (Input::KeyPressed(Input::Key::R) || newLevel != nCurrentLevel) {
+  if (FrameKeyPressed(Input::Key::R) || newLevel != nCurrentLevel) {
+    // Whatever the worker still publishes for the old board is ignored.
+    ++nAutomataGeneration;
+    SendAutomataCommand(AutomataCommand::Type::Pause);
     nPaused = true;
     nAutomataStarted = false;
     nAutomataTimePassed = nStartTime;
@@ -595,17 +930,33 @@ void CentralUpdate() {
     LevelSetup(newLevel);
   }
 
+  if (FrameKeyPressed(Input::Key::F1)) {
+    nShowDebugPanel = !nShowDebugPanel;
+  }
+  if (nShowDebugPanel) {
+    DebugPanel();
+  }
+
+  nAutomata.Flush();
+  if (nAutomataStarted) {
+    UpdateGraphics();
+  }
+
   if (nRequirementsFulfilled) {
     return;
   }
 
-  if (Input::KeyPressed(Input::Key::Space)) {
+  if (FrameKeyPressed(Input::Key::Space)) {
     nPaused = !nPaused;
     if (nPaused) {
+      SendAutomataCommand(AutomataCommand::Type::Pause);
       nRunDisplay.Get<Comp::Text>().mText = "~=";
       nAutomataTimePassed = (float)(int)nAutomataTimePassed + 0.9f;
     }
     else {
+      if (!nAutomataStarted) {
+        LoadAutomata();
+      }
       nAutomataStarted = true;
       nRunDisplay.Get<Comp::Text>().mText = "~>";
       nCursor.mObject.Get<Comp::Sprite>().mVisible = false;
@@ -622,6 +973,7 @@ void CentralUpdate() {
 }
 
 void FieldSetup() {
+  MemoryScope scope(MemoryTag::FieldSetup);
   Gfx::Renderer::nClearColor = {0.02f, 0.02f, 0.02f, 1.0};
 
   World::LayerIt layerIt = World::nLayers.EmplaceBack("Field");
@@ -649,7 +1001,7 @@ void FieldSetup() {
   auto& runDisplayText = nRunDisplay.Add<Comp::Text>();
   runDisplayText.mColor = {1.0f, 1.0f, 1.0f, 1.0f};
   runDisplayText.mAlign = Comp::Text::Alignment::Center;
-  runDisplayText.mText = nRunDisplayStartText;
+  SetText(runDisplayText, nRunDisplayStartText);
 
   nLevelDisplay = field.CreateChild();
   auto& levelDisplayTransform = nLevelDisplay.Add<Comp::Transform>();
@@ -668,14 +1020,46 @@ void FieldSetup() {
   controlsText.mColor = {1.0f, 1.0f, 1.0f, 1.0f};
   controlsText.mAlign = Comp::Text::Alignment::Left;
   controlsText.mWidth = 39.0f;
-  controlsText.mText =
+  SetText(
+    controlsText,
     "Space: Start/Stop Automata\n"
     "R: Reset Digits\n"
     "Arrow Keys: Move Cursor\n"
     "S: Swap Cursor\n"
     "D: Select/Place/Exchange/Remove\n"
     "B/N: Previous or Next Level\n"
-    "== Means Success";
+    "== Means Success");
+
+  for (int x = 0; x < nFieldWidth; ++x) {
+    for (int y = 0; y < nFieldHeight; ++y) {
+      World::Object digitObject = space.CreateObject();
+      digitObject.Add<Digit>() = {{x, y}, 0, Direction::Right};
+      nCellDigits[x][y] = {digitObject.mMemberId, false};
+      auto& transform = digitObject.Add<Comp::Transform>();
+      transform.SetTranslation(nHiddenDigitTranslation);
+      transform.SetUniformScale(nDigitScale);
+      auto& sprite = digitObject.Add<Comp::Sprite>();
+      sprite.mMaterialId = "images:DigitBg";
+
+      World::Object textChildObject = digitObject.CreateChild();
+      auto& textTransform = textChildObject.Add<Comp::Transform>();
+      textTransform.SetTranslation({0.0f, -0.2f, 0.1f});
+      textTransform.SetUniformScale(0.4f);
+      auto& text = textChildObject.Add<Comp::Text>();
+      text.mColor = {1.0f, 1.0f, 1.0f, 1.0f};
+      text.mAlign = Comp::Text::Alignment::Center;
+      SetText(text, "0");
+
+      World::Object arrowChildObject = digitObject.CreateChild();
+      auto& arrowTransform = arrowChildObject.Add<Comp::Transform>();
+      arrowTransform.SetUniformScale(0.3f);
+      auto& arrowText = arrowChildObject.Add<Comp::Text>();
+      arrowText.mColor = {1.0f, 1.0f, 1.0f, 1.0f};
+      arrowText.mAlign = Comp::Text::Alignment::Center;
+      SetText(arrowText, ">");
+      UpdateDigitArrowGraphic(digitObject.mMemberId);
+    }
+  }
 
   nCursor.mObject = space.CreateObject();
   auto& cursorTransform = nCursor.mObject.Add<Comp::Transform>();
@@ -712,14 +1096,19 @@ void MakeLevelEmpty(bool resetModifiers) {
   nRequirementsFulfilled = false;
   InitializeLayers(resetModifiers);
 
-  Ds::Vector<MemberId> digitMemberIds = space.Slice<Digit>();
-  for (MemberId memberId: digitMemberIds) {
-    space.DeleteMember(memberId);
-  }
+  HideCellDigits();
   Ds::Vector<MemberId> requirementIds = space.Slice<Requirement>();
   for (MemberId memberId: requirementIds) {
     space.DeleteMember(memberId);
   }
+  Ds::Vector<MemberId> emitterIds = space.Slice<Emitter>();
+  for (MemberId memberId: emitterIds) {
+    space.DeleteMember(memberId);
+  }
+  Ds::Vector<MemberId> sinkIds = space.Slice<Sink>();
+  for (MemberId memberId: sinkIds) {
+    space.DeleteMember(memberId);
+  }
 
   if (resetModifiers) {
     Ds::Vector<MemberId> filterMemberIds = space.Slice<Filter>();
@@ -730,11 +1119,19 @@ void MakeLevelEmpty(bool resetModifiers) {
     for (MemberId memberId: shifterMemberIds) {
       space.DeleteMember(memberId);
     }
-    nPlaceableIds.Clear();
+    ReleaseStorage(nPlaceables.mSlots);
+    for (PlaceableGroup& group: nPlaceables.mGroups) {
+      ReleaseStorage(group.mFreeSlots);
+    }
+    ReleaseStorage(nModifierIds);
+    nLevelArena.Release();
+    nCursor.mPlaceableCell[0] = 0;
+    nCursor.mPlaceableCell[1] = 0;
   }
 }
 
 void AddLockingSprites(World::Object modifierObject) {
+  MemoryScope scope(MemoryTag::LockingSprites);
   // Indicate that modifiers which are not placeable cannot be moved.
   for (int i = 0; i < 4; ++i) {
     World::Object lockedSpriteId = modifierObject.CreateChild();
@@ -770,47 +1167,51 @@ void AddLockingSprites(World::Object modifierObject) {
   }
 }
 
+// Emitters and sinks look like locked modifiers with a label.
+void AddFixtureGraphics(
+  World::Object fixtureObject, const int cell[2], const char* label) {
+  auto& transform = fixtureObject.Add<Comp::Transform>();
+  Vec3 offset = {(float)cell[0], (float)cell[1], nModifierZ};
+  transform.SetTranslation(nFieldOrigin + offset);
+  transform.SetUniformScale(nModifierScale);
+  auto& sprite = fixtureObject.Add<Comp::Sprite>();
+  sprite.mMaterialId = "images:ModifierBg";
+
+  World::Object textChildObject = fixtureObject.CreateChild();
+  auto& textTransform = textChildObject.Add<Comp::Transform>();
+  textTransform.SetTranslation({0.0f, -0.25f, 0.1f});
+  textTransform.SetUniformScale(0.5f);
+  auto& text = textChildObject.Add<Comp::Text>();
+  text.mColor = {0.0f, 0.0f, 0.0f, 1.0f};
+  text.mAlign = Comp::Text::Alignment::Center;
+  SetText(text, label);
+  AddLockingSprites(fixtureObject);
+}
+
 void LevelSetup(size_t levelIdx) {
+  MemoryScope scope(MemoryTag::LevelSetup);
   bool resetModifiers = nCurrentLevel != levelIdx;
   nCurrentLevel = levelIdx;
   const Level& level = nLevels[levelIdx];
-  std::string levelText = "Level ";
-  levelText += std::to_string(nCurrentLevel + 1);
-  levelText += "/";
-  levelText += std::to_string(nLevels.Size());
-  levelText += ": ";
-  levelText += level.mName;
-  nLevelDisplay.Get<Comp::Text>().mText = levelText;
-
   MakeLevelEmpty(resetModifiers);
+  Label levelText;
+  levelText.Append("Level ").Append(nCurrentLevel + 1).Append("/");
+  levelText.Append(nLevelCount).Append(": ").Append(level.mName);
+  SetText(nLevelDisplay.Get<Comp::Text>(), levelText.mText);
+
   World::Space& space = World::nLayers.Back()->mSpace;
   for (const Digit& digit: level.mDigits) {
-    World::Object digitObject = space.CreateObject();
-    digitObject.Add<Digit>() = digit;
-    auto& transform = digitObject.Add<Comp::Transform>();
-    Vec3 offset = {(float)digit.mCell[0], (float)digit.mCell[1], nDigitZ};
-    transform.SetTranslation(nFieldOrigin + offset);
-    transform.SetUniformScale(nDigitScale);
-    auto& sprite = digitObject.Add<Comp::Sprite>();
-    sprite.mMaterialId = "images:DigitBg";
-
-    World::Object textChildObject = digitObject.CreateChild();
-    auto& textTransform = textChildObject.Add<Comp::Transform>();
-    textTransform.SetTranslation({0.0f, -0.2f, 0.1f});
-    textTransform.SetUniformScale(0.4f);
-    auto& text = textChildObject.Add<Comp::Text>();
-    text.mColor = {1.0f, 1.0f, 1.0f, 1.0f};
-    text.mAlign = Comp::Text::Alignment::Center;
-    text.mText = std::to_string(digit.mValue);
-
-    World::Object arrowChildObject = digitObject.CreateChild();
-    auto& arrowTransform = arrowChildObject.Add<Comp::Transform>();
-    arrowTransform.SetUniformScale(0.3f);
-    auto& arrowText = arrowChildObject.Add<Comp::Text>();
-    arrowText.mColor = {1.0f, 1.0f, 1.0f, 1.0f};
-    arrowText.mAlign = Comp::Text::Alignment::Center;
-    arrowText.mText = ">";
-    UpdateDigitArrowGraphic(digitObject.mMemberId);
+    ShowCellDigit(
+      digit.mCell[0], digit.mCell[1], {true, digit.mValue, digit.mDirection});
+    nDigitLayer[digit.mCell[0]][digit.mCell[1]] =
+      nCellDigits[digit.mCell[0]][digit.mCell[1]].mMemberId;
+  }
+  // Emitted digits appear on tick 0, so they show before the start too.
+  for (const Emitter& emitter: level.mEmitters) {
+    ShowCellDigit(
+      emitter.mCell[0],
+      emitter.mCell[1],
+      {true, emitter.mValue, emitter.mDirection});
   }
 
   for (const Requirement& requirement: level.mRequirements) {
@@ -831,13 +1232,29 @@ void LevelSetup(size_t levelIdx) {
     auto& text = textChildObject.Add<Comp::Text>();
     text.mColor = {1.0f, 1.0f, 1.0f, 1.0f};
     text.mAlign = Comp::Text::Alignment::Center;
-    text.mText = std::to_string(requirement.mValue);
+    SetText(text, Label().Append(requirement.mValue).mText);
+  }
+
+  for (const Emitter& emitter: level.mEmitters) {
+    World::Object emitterObject = space.CreateObject();
+    emitterObject.Add<Emitter>() = emitter;
+    Label label;
+    label.Append("E").Append(emitter.mPeriod);
+    AddFixtureGraphics(emitterObject, emitter.mCell, label.mText);
+  }
+  for (const Sink& sink: level.mSinks) {
+    World::Object sinkObject = space.CreateObject();
+    sinkObject.Add<Sink>() = sink;
+    AddFixtureGraphics(sinkObject, sink.mCell, "X");
   }
 
   if (resetModifiers) {
+    ResetPlaceables(level);
+    nModifierIds.reserve(level.mFilters.size() + level.mShifters.size());
     for (const Filter& filter: level.mFilters) {
       World::Object filterObject = space.CreateObject();
       filterObject.Add<Filter>() = filter;
+      nModifierIds.push_back(filterObject.mMemberId);
       auto& transform = filterObject.Add<Comp::Transform>();
       Vec3 offset = {
         (float)filter.mStartCell[0], (float)filter.mStartCell[1], nModifierZ};
@@ -853,17 +1270,18 @@ void LevelSetup(size_t levelIdx) {
       auto& text = textChildObject.Add<Comp::Text>();
       text.mColor = {0.0f, 0.0f, 0.0f, 1.0f};
       text.mAlign = Comp::Text::Alignment::Center;
-      std::string filterChar = "";
+      Label label;
       switch (filter.mType) {
-      case Filter::Type::Add: filterChar = "+"; break;
-      case Filter::Type::Sub: filterChar = "-"; break;
-      case Filter::Type::Mul: filterChar = "*"; break;
-      case Filter::Type::Mod: filterChar = "%"; break;
+      case Filter::Type::Add: label.Append("+"); break;
+      case Filter::Type::Sub: label.Append("-"); break;
+      case Filter::Type::Mul: label.Append("*"); break;
+      case Filter::Type::Mod: label.Append("%"); break;
       }
-      text.mText = filterChar + std::to_string(filter.mValue);
+      label.Append(filter.mValue);
+      SetText(text, label.mText);
 
       if (filter.mPlaceable) {
-        nPlaceableIds.Push(filterObject.mMemberId);
+        StockPlaceable(filterObject.mMemberId);
       }
       else {
         AddLockingSprites(filterObject);
@@ -873,6 +1291,7 @@ void LevelSetup(size_t levelIdx) {
     for (const Shifter& shifter: level.mShifters) {
       World::Object shifterObject = space.CreateObject();
       shifterObject.Add<Shifter>() = shifter;
+      nModifierIds.push_back(shifterObject.mMemberId);
       auto& transform = shifterObject.Add<Comp::Transform>();
       Vec3 offset = {
         (float)shifter.mStartCell[0], (float)shifter.mStartCell[1], nModifierZ};
@@ -901,28 +1320,32 @@ void LevelSetup(size_t levelIdx) {
       auto& text = textChildObject.Add<Comp::Text>();
       text.mColor = {0.0f, 0.0f, 0.0f, 1.0f};
       text.mAlign = Comp::Text::Alignment::Center;
-      text.mText = ">";
+      SetText(text, ">");
 
       if (shifter.mPlaceable) {
-        nPlaceableIds.Push(shifterObject.mMemberId);
+        StockPlaceable(shifterObject.mMemberId);
       }
       else {
         AddLockingSprites(shifterObject);
       }
     }
-    UpdatePlaceableGraphics();
   }
 
-  Ds::Vector<MemberId> digitIds = space.Slice<Digit>();
-  for (MemberId memberId: digitIds) {
-    auto& digit = space.Get<Digit>(memberId);
-    nDigitLayer[digit.mCell[0]][digit.mCell[1]] = memberId;
-  }
   Ds::Vector<MemberId> requirementIds = space.Slice<Requirement>();
   for (MemberId memberId: requirementIds) {
     auto& requirement = space.Get<Requirement>(memberId);
     nRequirementLayer[requirement.mCell[0]][requirement.mCell[1]] = memberId;
   }
+  Ds::Vector<MemberId> emitterIds = space.Slice<Emitter>();
+  for (MemberId memberId: emitterIds) {
+    auto& emitter = space.Get<Emitter>(memberId);
+    nFixtureLayer[emitter.mCell[0]][emitter.mCell[1]] = memberId;
+  }
+  Ds::Vector<MemberId> sinkIds = space.Slice<Sink>();
+  for (MemberId memberId: sinkIds) {
+    auto& sink = space.Get<Sink>(memberId);
+    nFixtureLayer[sink.mCell[0]][sink.mCell[1]] = memberId;
+  }
   if (resetModifiers) {
     Ds::Vector<MemberId> filterIds = space.Slice<Filter>();
     for (MemberId memberId: filterIds) {
@@ -939,6 +1362,185 @@ void LevelSetup(size_t levelIdx) {
       }
     }
   }
+  nLevelArena.RecordLoad();
+  RecordLoadMemory();
+}
+
+struct KeyName {
+  const char* mName;
+  Input::Key mKey;
+};
+constexpr KeyName nPlaybackKeys[] = {
+  {"Up", Input::Key::Up},
+  {"Right", Input::Key::Right},
+  {"Down", Input::Key::Down},
+  {"Left", Input::Key::Left},
+  {"S", Input::Key::S},
+  {"D", Input::Key::D},
+  {"Space", Input::Key::Space},
+  {"R", Input::Key::R},
+  {"B", Input::Key::B},
+  {"N", Input::Key::N},
+};
+
+// Every line of a script is a frame count followed by the keys pressed on
+// each of those frames, e.g. "1 S D" or "600" to let that many frames pass.
+// Everything after a # is ignored.
+bool LoadPlaybackScript(const char* path) {
+  std::ifstream file(path);
+  if (!file) {
+    std::fprintf(stderr, "Unable to open %s.\n", path);
+    return false;
+  }
+  std::string line;
+  for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+    std::istringstream words(line.substr(0, line.find('#')));
+    int frameCount;
+    if (!(words >> frameCount)) {
+      continue;
+    }
+    if (frameCount <= 0) {
+      std::fprintf(
+        stderr, "%s:%d: Bad frame count %d.\n", path, lineNumber, frameCount);
+      return false;
+    }
+    std::vector<Input::Key> keys;
+    std::string word;
+    while (words >> word) {
+      const KeyName* keyName = std::find_if(
+        std::begin(nPlaybackKeys),
+        std::end(nPlaybackKeys),
+        [&](const KeyName& keyName) {
+          return word == keyName.mName;
+        });
+      if (keyName == std::end(nPlaybackKeys)) {
+        std::fprintf(
+          stderr, "%s:%d: Unknown key %s.\n", path, lineNumber, word.c_str());
+        return false;
+      }
+      keys.push_back(keyName->mKey);
+    }
+    nPlayback.mFrames.insert(nPlayback.mFrames.end(), frameCount, keys);
+  }
+  return true;
+}
+
+// Visits every level in order. Each one gets a walk over the field that tries
+// to place at every stop, a run of the automata, a reset and more placing.
+void MakeDefaultPlaybackScript() {
+  auto add = [](int frameCount, std::vector<Input::Key> keys) {
+    nPlayback.mFrames.insert(nPlayback.mFrames.end(), frameCount, keys);
+  };
+  using Key = Input::Key;
+  for (int i = 0; i < nLevelCount; ++i) {
+    for (int j = 0; j < 2 * nFieldWidth; ++j) {
+      add(1, {Key::S});
+      add(1, {Key::Right});
+      add(1, {Key::D});
+      add(1, {j % 3 == 0 ? Key::Up : Key::Right});
+      add(1, {Key::D});
+      add(1, {});
+    }
+    add(1, {Key::Space});
+    add(600, {});
+    add(1, {Key::Space});
+    add(30, {});
+    add(1, {Key::R});
+    for (int j = 0; j < nFieldWidth; ++j) {
+      add(1, {Key::Left});
+      add(1, {Key::D});
+    }
+    add(30, {});
+    if (i + 1 < nLevelCount) {
+      add(1, {Key::N});
+    }
+  }
+}
+
+enum class FramePhase {
+  PlaceMode,
+  Running,
+  LevelSwitch,
+  Other,
+  Count,
+};
+constexpr int nFramePhaseCount = (int)FramePhase::Count;
+constexpr const char* nFramePhaseNames[nFramePhaseCount] = {
+  "Place Mode",
+  "Running",
+  "Level Switch",
+  "Other",
+};
+
+// The phase is decided before the frame runs, from the state it starts in and
+// the keys it sees.
+FramePhase CurrentFramePhase() {
+  if (
+    FrameKeyPressed(Input::Key::R) || FrameKeyPressed(Input::Key::B) ||
+    FrameKeyPressed(Input::Key::N)) {
+    return FramePhase::LevelSwitch;
+  }
+  if (!nPaused && !nRequirementsFulfilled) {
+    return FramePhase::Running;
+  }
+  if (!nAutomataStarted) {
+    return FramePhase::PlaceMode;
+  }
+  return FramePhase::Other;
+}
+
+// Returns the time below which the given share of the sorted times fall.
+double Percentile(const std::vector<double>& sortedTimes, double share) {
+  size_t index = (size_t)(share * (double)(sortedTimes.size() - 1) + 0.5);
+  return sortedTimes[index];
+}
+
+// Calls CentralUpdate once for every frame of the script without rendering
+// and prints the frame times of every phase. A frame's time includes waiting
+// on the worker for the steps it sent, so the worker's own step times are
+// printed on their own as well.
+void RunPlayback() {
+  using Clock = std::chrono::steady_clock;
+  std::vector<double> frameTimes[nFramePhaseCount];
+  nPlayback.mFrame = 0;
+  for (; nPlayback.mFrame < nPlayback.mFrames.size(); ++nPlayback.mFrame) {
+    FramePhase phase = CurrentFramePhase();
+    Clock::time_point start = Clock::now();
+    CentralUpdate();
+    WaitForAutomata();
+    std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+    frameTimes[(int)phase].push_back(elapsed.count());
+  }
+
+  std::printf(
+    "Playback: %zu frames, %.4fs per frame, ended on level %d\n",
+    nPlayback.mFrames.size(),
+    nPlaybackDeltaTime,
+    nCurrentLevel + 1);
+  std::printf(
+    "%-14s %8s %10s %10s %10s\n",
+    "Phase",
+    "Frames",
+    "p50 us",
+    "p99 us",
+    "max us");
+  auto printTimes = [](const char* name, std::vector<double>& times) {
+    if (times.empty()) {
+      return;
+    }
+    std::sort(times.begin(), times.end());
+    std::printf(
+      "%-14s %8zu %10.1f %10.1f %10.1f\n",
+      name,
+      times.size(),
+      Percentile(times, 0.5),
+      Percentile(times, 0.99),
+      times.back());
+  };
+  for (int i = 0; i < nFramePhaseCount; ++i) {
+    printTimes(nFramePhaseNames[i], frameTimes[i]);
+  }
+  printTimes("Worker Step", nPlayback.mStepTimes);
 }
 
 void RegisterCustomTypes() {
@@ -946,25 +1548,52 @@ void RegisterCustomTypes() {
   RegisterComponent(Requirement);
   RegisterComponent(Filter);
   RegisterComponent(Shifter);
+  RegisterComponent(Emitter);
+  RegisterComponent(Sink);
 }
 
 int main(int argc, char* argv[]) {
+  // The playback options are taken out before the engine sees the rest.
+  std::vector<char*> args = {argv[0]};
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--playback") != 0) {
+      args.push_back(argv[i]);
+      continue;
+    }
+    nPlayback.mActive = true;
+    bool hasScript = i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0;
+    if (hasScript && !LoadPlaybackScript(argv[++i])) {
+      return 1;
+    }
+  }
+  if (nPlayback.mActive && nPlayback.mFrames.empty()) {
+    MakeDefaultPlaybackScript();
+  }
+
   Registrar::nRegisterCustomTypes = RegisterCustomTypes;
   Options::Config config;
   config.mWindowName = "Filtern";
   config.mProjectDirectory = PROJECT_DIRECTORY;
   config.mEditorLevel = Options::EditorLevel::Simple;
-  Result result = VarkorInit(argc, argv, std::move(config));
+  Result result =
+    VarkorInit((int)args.size(), args.data(), std::move(config));
   LogAbortIf(!result.Success(), result.mError.c_str());
 
   Editor::nPlayMode = true;
   World::nPause = false;
 
-  CreateLevels();
   FieldSetup();
   LevelSetup(0);
   World::nCentralUpdate = CentralUpdate;
+  nAutomata.Start(TagAutomataThread);
 
-  VarkorRun();
+  if (nPlayback.mActive) {
+    RunPlayback();
+  }
+  else {
+    VarkorRun();
+  }
+  nAutomata.Stop();
   VarkorPurge();
+  DumpMemory();
 }
@@ -0,0 +1,312 @@
+// Removes levels from a pack that are the same puzzle as an earlier level
+// under a symmetry of the field or a reordering of its elements (see
+// Pack::CanonicalLevel). The pack is
+// streamed in batches. Workers find the canonical hashes of a batch in
+// parallel and a writer takes the batches in pack order, so the first copy of
+// every level is the one kept. Only a bounded number of batches are in flight
+// and the index holds one hash per unique level.
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "LevelPack.h"
+#include "Solver.h"
+#include "SolverProtocol.h"
+
+constexpr size_t nBatchSize = 512;
+
+struct Entry {
+  Protocol::Request mRequest;
+  uint64_t mHash;
+};
+
+struct Batch {
+  size_t mIndex = 0;
+  std::vector<Entry> mEntries;
+};
+
+struct Pipeline {
+  // Reader side. Blocks while too many batches are in flight.
+  void Submit(Batch&& batch);
+  void FinishReading();
+  void Work();
+  void Write();
+
+  std::ostream* mOutput;
+  bool mWriteCanonical;
+  size_t mMaxInFlight;
+
+  std::mutex mMutex;
+  std::condition_variable mReadyForReader;
+  std::condition_variable mReadyForWorker;
+  std::condition_variable mReadyForWriter;
+  std::vector<Batch> mPending;
+  std::map<size_t, Batch> mHashed;
+  size_t mInFlight = 0;
+  size_t mSubmitted = 0;
+  bool mReadingDone = false;
+
+  // Writer only.
+  std::unordered_set<uint64_t> mIndex;
+  size_t mLevels = 0;
+  size_t mDuplicates = 0;
+};
+
+void Pipeline::Submit(Batch&& batch) {
+  std::unique_lock<std::mutex> lock(mMutex);
+  mReadyForReader.wait(lock, [this]() {
+    return mInFlight < mMaxInFlight;
+  });
+  ++mInFlight;
+  ++mSubmitted;
+  mPending.push_back(std::move(batch));
+  mReadyForWorker.notify_one();
+}
+
+void Pipeline::FinishReading() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mReadingDone = true;
+  mReadyForWorker.notify_all();
+  mReadyForWriter.notify_one();
+}
+
+void Pipeline::Work() {
+  while (true) {
+    Batch batch;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mReadyForWorker.wait(lock, [this]() {
+        return !mPending.empty() || mReadingDone;
+      });
+      if (mPending.empty()) {
+        return;
+      }
+      batch = std::move(mPending.back());
+      mPending.pop_back();
+    }
+    for (Entry& entry: batch.mEntries) {
+      entry.mHash = Pack::CanonicalHash(entry.mRequest.mLevel);
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    mHashed.emplace(batch.mIndex, std::move(batch));
+    mReadyForWriter.notify_one();
+  }
+}
+
+void Pipeline::Write() {
+  for (size_t index = 0;; ++index) {
+    Batch batch;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mReadyForWriter.wait(lock, [&]() {
+        return mHashed.count(index) > 0 ||
+          (mReadingDone && index == mSubmitted);
+      });
+      auto it = mHashed.find(index);
+      if (it == mHashed.end()) {
+        return;
+      }
+      batch = std::move(it->second);
+      mHashed.erase(it);
+    }
+    for (Entry& entry: batch.mEntries) {
+      ++mLevels;
+      if (!mIndex.insert(entry.mHash).second) {
+        ++mDuplicates;
+        continue;
+      }
+      if (mOutput == nullptr) {
+        continue;
+      }
+      // Fixed cells don't survive the reordering, so canonical levels are
+      // written with every placeable free.
+      if (mWriteCanonical) {
+        int symmetry;
+        entry.mRequest.mLevel =
+          Pack::CanonicalLevel(entry.mRequest.mLevel, &symmetry);
+        entry.mRequest.mPartial.assign(
+          Sim::PlaceableCount(entry.mRequest.mLevel), Solver::nFreeCell);
+      }
+      *mOutput << Protocol::WriteRequest(entry.mRequest);
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    --mInFlight;
+    mReadyForReader.notify_one();
+  }
+}
+
+// Pairs of levels that differ only in an order canonical forms must keep.
+// Each pair has to hash differently and every canonical form has to run like
+// the level it came from.
+struct CheckCase {
+  const char* mName;
+  Sim::LevelDesc mLevels[2];
+};
+
+std::vector<CheckCase> MakeCheckCases() {
+  // The digits meet on the requirement's cell after one tick. Only when the 1
+  // comes second does it win the digit layer and solve the level.
+  Sim::LevelDesc meeting;
+  meeting.mWidth = 3;
+  meeting.mHeight = 1;
+  meeting.mRequirements.push_back({{1, 0}, 1});
+  Sim::LevelDesc swapped = meeting;
+  meeting.mDigits = {
+    {{0, 0}, 1, Direction::Right}, {{2, 0}, 2, Direction::Left}};
+  swapped.mDigits = {meeting.mDigits[1], meeting.mDigits[0]};
+  return {{"digit order on a shared cell", {meeting, swapped}}};
+}
+
+Sim::RunResult RunLevel(const Sim::LevelDesc& levelDesc) {
+  Sim::Board board;
+  board.Init(levelDesc);
+  Sim::Simulation simulation;
+  return Sim::Run(simulation, board, Sim::DefaultMaxTicks(levelDesc));
+}
+
+bool SameRun(const Sim::RunResult& a, const Sim::RunResult& b) {
+  return a.mSolved == b.mSolved && a.mTick == b.mTick &&
+    a.mDecided == b.mDecided;
+}
+
+int RunChecks() {
+  int failures = 0;
+  for (const CheckCase& check: MakeCheckCases()) {
+    bool passed = Pack::CanonicalHash(check.mLevels[0]) !=
+      Pack::CanonicalHash(check.mLevels[1]);
+    for (const Sim::LevelDesc& level: check.mLevels) {
+      int symmetry;
+      Sim::LevelDesc canonical = Pack::CanonicalLevel(level, &symmetry);
+      passed = passed && SameRun(RunLevel(level), RunLevel(canonical));
+    }
+    std::printf("%s: %s\n", passed ? "pass" : "FAIL", check.mName);
+    failures += passed ? 0 : 1;
+  }
+  return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+  const char* inPath = nullptr;
+  const char* outPath = nullptr;
+  bool writeCanonical = false;
+  int threadCount = std::max(1u, std::thread::hardware_concurrency());
+  for (int i = 1; i < argc; ++i) {
+    bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--in") == 0 && hasValue) {
+      inPath = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--out") == 0 && hasValue) {
+      outPath = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--canonical") == 0) {
+      writeCanonical = true;
+    }
+    else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+      threadCount = std::max(1, std::atoi(argv[++i]));
+    }
+    else if (std::strcmp(argv[i], "--check") == 0) {
+      return RunChecks();
+    }
+    else {
+      std::fprintf(
+        stderr,
+        "usage: %s [--in path] [--out path] [--canonical] [--threads count]\n"
+        "       %s --check\n"
+        "  Reads stdin when no input is given. --check runs the canonical\n"
+        "  form regression cases.\n",
+        argv[0],
+        argv[0]);
+      return 1;
+    }
+  }
+
+  std::ifstream inFile;
+  std::istream* input = &std::cin;
+  if (inPath != nullptr) {
+    inFile.open(inPath);
+    if (!inFile) {
+      std::fprintf(stderr, "Unable to open %s.\n", inPath);
+      return 1;
+    }
+    input = &inFile;
+  }
+  std::ofstream outFile;
+  if (outPath != nullptr) {
+    outFile.open(outPath);
+    if (!outFile) {
+      std::fprintf(stderr, "Unable to create %s.\n", outPath);
+      return 1;
+    }
+  }
+
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+  Pipeline pipeline;
+  pipeline.mOutput = outPath != nullptr ? &outFile : nullptr;
+  pipeline.mWriteCanonical = writeCanonical;
+  pipeline.mMaxInFlight = 2 * threadCount + 2;
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threadCount; ++i) {
+    workers.emplace_back(&Pipeline::Work, &pipeline);
+  }
+  std::thread writer(&Pipeline::Write, &pipeline);
+
+  // A level that fails to parse is skipped up to the next level line.
+  Protocol::RequestParser parser;
+  Batch batch;
+  size_t invalidCount = 0;
+  bool skipping = false;
+  std::string line;
+  while (std::getline(*input, line)) {
+    if (skipping) {
+      if (line.rfind("level", 0) != 0) {
+        continue;
+      }
+      skipping = false;
+    }
+    Protocol::ParseStatus status = parser.Feed(line);
+    if (status == Protocol::ParseStatus::Error) {
+      ++invalidCount;
+      skipping = true;
+    }
+    else if (status == Protocol::ParseStatus::Done) {
+      batch.mEntries.push_back({parser.mRequest, 0});
+      if (batch.mEntries.size() == nBatchSize) {
+        size_t nextIndex = batch.mIndex + 1;
+        pipeline.Submit(std::move(batch));
+        batch = Batch();
+        batch.mIndex = nextIndex;
+      }
+    }
+  }
+  if (!batch.mEntries.empty()) {
+    pipeline.Submit(std::move(batch));
+  }
+  pipeline.FinishReading();
+  for (std::thread& worker: workers) {
+    worker.join();
+  }
+  writer.join();
+
+  auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+    Clock::now() - start);
+  std::fprintf(
+    stderr,
+    "%zu levels, %zu unique, %zu duplicates, %zu invalid (%lldms)\n",
+    pipeline.mLevels,
+    pipeline.mIndex.size(),
+    pipeline.mDuplicates,
+    invalidCount,
+    (long long)milliseconds.count());
+}
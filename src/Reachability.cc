@@ -0,0 +1,165 @@
+#include <algorithm>
+
+#include "Reachability.h"
+#include "Solver.h"
+
+namespace Reach {
+
+constexpr int nValueCount = 10;
+constexpr int nDirectionCount = 4;
+
+bool Analysis::Run(
+  const Sim::LevelDesc& levelDesc, const Sim::Placement& partial) {
+  mLevel = &levelDesc;
+  mBoard.Init(levelDesc);
+  std::vector<int> placeableModifiers = Sim::PlaceableModifiers(levelDesc);
+  std::vector<int> groups = Solver::IdenticalGroups(levelDesc);
+  // Identical free placeables have the same effect, so one of each will do.
+  mFreeModifiers.clear();
+  std::vector<bool> freeGroups(partial.size(), false);
+  for (size_t i = 0; i < partial.size(); ++i) {
+    if (partial[i] >= 0) {
+      mBoard.SetModifier(partial[i], placeableModifiers[i]);
+    }
+    else if (partial[i] == Solver::nFreeCell && !freeGroups[groups[i]]) {
+      freeGroups[groups[i]] = true;
+      mFreeModifiers.push_back(placeableModifiers[i]);
+    }
+  }
+
+  size_t stateCount = (size_t)mBoard.CellCount() * nValueCount;
+  int sourceCount =
+    (int)(levelDesc.mDigits.size() + levelDesc.mEmitters.size());
+  mReachable.assign(sourceCount * stateCount, 0);
+  for (int i = 0; i < sourceCount; ++i) {
+    Explore(i);
+  }
+  return MatchRequirements();
+}
+
+bool Analysis::Reachable(int sourceIdx, int cell, int value) const {
+  size_t stateCount = (size_t)mBoard.CellCount() * nValueCount;
+  return mReachable[sourceIdx * stateCount + cell * nValueCount + value] != 0;
+}
+
+// A state packs the cell, value and direction of a digit into one int.
+int PackState(int cell, int value, Direction direction) {
+  return (cell * nValueCount + value) * nDirectionCount + (int)direction;
+}
+
+void Analysis::Explore(int sourceIdx) {
+  const Sim::LevelDesc& level = *mLevel;
+  int filterCount = (int)level.mFilters.size();
+  uint8_t* directions =
+    mReachable.data() + (size_t)sourceIdx * mBoard.CellCount() * nValueCount;
+  mQueue.clear();
+  int digitCount = (int)level.mDigits.size();
+  if (sourceIdx < digitCount) {
+    const Digit& start = level.mDigits[sourceIdx];
+    mQueue.push_back(
+      PackState(mBoard.CellIndex(start.mCell), start.mValue, start.mDirection));
+  }
+  else {
+    const Emitter& start = level.mEmitters[sourceIdx - digitCount];
+    mQueue.push_back(
+      PackState(mBoard.CellIndex(start.mCell), start.mValue, start.mDirection));
+  }
+
+  // Every queued state is one a digit can leave. The states a step leads to
+  // are visited and reachable.
+  auto visit = [&](int cell, int value, Direction direction) {
+    uint8_t& visited = directions[cell * nValueCount + value];
+    uint8_t bit = (uint8_t)(1 << (int)direction);
+    if ((visited & bit) == 0) {
+      visited |= bit;
+      mQueue.push_back(PackState(cell, value, direction));
+    }
+  };
+  auto apply = [&](int cell, int value, Direction direction, int modifier) {
+    if (modifier < filterCount) {
+      value = ApplyFilter(level.mFilters[modifier], value);
+    }
+    else {
+      direction = level.mShifters[modifier - filterCount].mDirection;
+    }
+    visit(cell, value, direction);
+  };
+  for (size_t head = 0; head < mQueue.size(); ++head) {
+    int state = mQueue[head];
+    Direction direction = (Direction)(state % nDirectionCount);
+    int value = state / nDirectionCount % nValueCount;
+    int cellIdx = state / nDirectionCount / nValueCount;
+    int cell[2] = {cellIdx % level.mWidth, cellIdx / level.mWidth};
+    switch (direction) {
+    case Direction::Up: cell[1] += 1; break;
+    case Direction::Right: cell[0] += 1; break;
+    case Direction::Down: cell[1] -= 1; break;
+    case Direction::Left: cell[0] -= 1; break;
+    }
+    cell[0] = std::clamp(cell[0], 0, level.mWidth - 1);
+    cell[1] = std::clamp(cell[1], 0, level.mHeight - 1);
+    int nextCell = mBoard.CellIndex(cell);
+    if (Sim::DescKind(mBoard.mCellDescs[nextCell]) == Sim::CellKind::Sink) {
+      continue;
+    }
+
+    int modifier = mBoard.mModifiers[nextCell];
+    if (modifier != Sim::nNoModifier) {
+      apply(nextCell, value, direction, modifier);
+      continue;
+    }
+    visit(nextCell, value, direction);
+    if (mBoard.Placeable(nextCell)) {
+      for (int freeModifier: mFreeModifiers) {
+        apply(nextCell, value, direction, freeModifier);
+      }
+    }
+  }
+}
+
+bool Analysis::MatchRequirements() {
+  // Requirements checked on the same tick need different digits.
+  mMatches.assign(mLevel->mRequirements.size(), Sim::nNoDigit);
+  std::vector<bool> tried;
+  int digitCount = (int)mLevel->mDigits.size();
+  for (int i = 0; i < (int)mLevel->mRequirements.size(); ++i) {
+    // Emitters keep making digits, so one can serve any number of
+    // requirements.
+    const Requirement& requirement = mLevel->mRequirements[i];
+    int cell = mBoard.CellIndex(requirement.mCell);
+    bool emitted = false;
+    for (int j = 0; j < (int)mLevel->mEmitters.size(); ++j) {
+      emitted |= Reachable(digitCount + j, cell, requirement.mValue);
+    }
+    if (emitted) {
+      continue;
+    }
+    tried.assign(digitCount, false);
+    if (!Augment(i, tried)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Analysis::Augment(int requirementIdx, std::vector<bool>& tried) {
+  const Requirement& requirement = mLevel->mRequirements[requirementIdx];
+  int cell = mBoard.CellIndex(requirement.mCell);
+  for (int i = 0; i < (int)mLevel->mDigits.size(); ++i) {
+    if (tried[i] || !Reachable(i, cell, requirement.mValue)) {
+      continue;
+    }
+    tried[i] = true;
+    // The digit is free or its requirement can move to another digit.
+    auto matched = std::find(mMatches.begin(), mMatches.end(), i);
+    if (
+      matched == mMatches.end() ||
+      Augment((int)(matched - mMatches.begin()), tried)) {
+      mMatches[requirementIdx] = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace Reach
@@ -0,0 +1,47 @@
+#ifndef Reachability_h
+#define Reachability_h
+
+#include <cstdint>
+#include <vector>
+
+#include "Simulation.h"
+
+// A static pre-pass that proves levels or partial placements unsolvable
+// without simulating them.
+namespace Reach {
+
+// Finds every (cell, value) each digit could be at after some step, for any
+// completion of a partial placement. Free placeables (Solver::nFreeCell) might
+// be on any cell that can hold one, so every free cell a digit enters can
+// leave it alone or apply any free placeable. That overestimates what a real
+// placement can do, since a placeable only goes on one cell, which keeps
+// every rejection sound. A level is rejected when its requirements can't be
+// matched to distinct digits that reach them. Emitters are explored like
+// digits but can meet any number of requirements, and digits stop at sinks.
+struct Analysis {
+  // Returns false when no completion of partial can meet every requirement.
+  bool Run(const Sim::LevelDesc& levelDesc, const Sim::Placement& partial);
+  // Sources are the level's digits followed by its emitters.
+  bool Reachable(int sourceIdx, int cell, int value) const;
+
+private:
+  void Explore(int sourceIdx);
+  bool MatchRequirements();
+  bool Augment(int requirementIdx, std::vector<bool>& tried);
+
+  const Sim::LevelDesc* mLevel;
+  Sim::Board mBoard;
+  // The distinct modifier ids of the free placeables.
+  std::vector<int> mFreeModifiers;
+  // For every source, cell and value, a bit for each direction its digits
+  // can have there. A cell and value is reachable when any bit is set.
+  std::vector<uint8_t> mReachable;
+  // Scratch space for exploring (cell, value, direction) states.
+  std::vector<int> mQueue;
+  // The digit matched to every requirement, or Sim::nNoDigit.
+  std::vector<int> mMatches;
+};
+
+} // namespace Reach
+
+#endif
@@ -0,0 +1,674 @@
+#include <algorithm>
+#include <functional>
+
+#include "Simulation.h"
+
+namespace Sim {
+
+LevelDesc MakeLevelDesc(const Level& level) {
+  LevelDesc levelDesc;
+  levelDesc.mWidth = nFieldWidth;
+  levelDesc.mHeight = nFieldHeight;
+  levelDesc.mDigits.assign(level.mDigits.begin(), level.mDigits.end());
+  levelDesc.mRequirements.assign(
+    level.mRequirements.begin(), level.mRequirements.end());
+  levelDesc.mFilters.assign(level.mFilters.begin(), level.mFilters.end());
+  levelDesc.mShifters.assign(level.mShifters.begin(), level.mShifters.end());
+  levelDesc.mEmitters.assign(level.mEmitters.begin(), level.mEmitters.end());
+  levelDesc.mSinks.assign(level.mSinks.begin(), level.mSinks.end());
+  return levelDesc;
+}
+
+Level ViewLevelDesc(const LevelDesc& levelDesc) {
+  return {
+    "",
+    levelDesc.mDigits,
+    levelDesc.mRequirements,
+    levelDesc.mFilters,
+    levelDesc.mShifters,
+    levelDesc.mEmitters,
+    levelDesc.mSinks};
+}
+
+bool ValidFieldSize(int width, int height) {
+  return width > 0 && height > 0 &&
+    (int64_t)width * height <= nMaxFieldCells;
+}
+
+// What a cell holds in ValidSharedCells.
+constexpr uint8_t nRequirementOnCell = 1;
+constexpr uint8_t nLockedModifierOnCell = 2;
+constexpr uint8_t nEmitterOnCell = 4;
+constexpr uint8_t nSinkOnCell = 8;
+constexpr uint8_t nFixtureOnCell = nEmitterOnCell | nSinkOnCell;
+
+// ValidateSharedCells in linear time. Runtime fields can have nMaxFieldCells
+// cells, where comparing every pair of elements would take minutes. Every
+// cell instead records what has been put on it so far.
+bool ValidSharedCells(const LevelDesc& levelDesc, std::string* error) {
+  std::vector<uint8_t> cells((size_t)levelDesc.mWidth * levelDesc.mHeight, 0);
+  auto at = [&](const int cell[2]) -> uint8_t& {
+    return cells[(size_t)cell[1] * levelDesc.mWidth + cell[0]];
+  };
+  auto fail = [error](const char* message) {
+    *error = message;
+    return false;
+  };
+
+  // Shared modifier cells are reported after the requirements, like
+  // ValidateSharedCells does, so both give the same first message.
+  bool sharedModifierCell = false;
+  auto placeLockedModifier = [&](const int cell[2]) {
+    sharedModifierCell |= (at(cell) & nLockedModifierOnCell) != 0;
+    at(cell) |= nLockedModifierOnCell;
+  };
+  for (const Filter& filter: levelDesc.mFilters) {
+    if (!filter.mPlaceable) {
+      placeLockedModifier(filter.mStartCell);
+    }
+  }
+  for (const Shifter& shifter: levelDesc.mShifters) {
+    if (!shifter.mPlaceable) {
+      placeLockedModifier(shifter.mStartCell);
+    }
+  }
+  for (const Requirement& requirement: levelDesc.mRequirements) {
+    uint8_t& cell = at(requirement.mCell);
+    if (cell & nLockedModifierOnCell) {
+      return fail("Requirement is on top of a locked modifier.");
+    }
+    if (cell & nRequirementOnCell) {
+      return fail("Two requirements share a cell.");
+    }
+    cell |= nRequirementOnCell;
+  }
+  if (sharedModifierCell) {
+    return fail("Two locked modifiers share a cell.");
+  }
+  for (const Emitter& emitter: levelDesc.mEmitters) {
+    uint8_t& cell = at(emitter.mCell);
+    if (cell & nEmitterOnCell) {
+      return fail("Two emitters share a cell.");
+    }
+    cell |= nEmitterOnCell;
+  }
+  for (const Sink& sink: levelDesc.mSinks) {
+    uint8_t& cell = at(sink.mCell);
+    if (cell & nEmitterOnCell) {
+      return fail("An emitter and a sink share a cell.");
+    }
+    if (cell & nSinkOnCell) {
+      return fail("Two sinks share a cell.");
+    }
+    cell |= nSinkOnCell;
+  }
+
+  for (const Digit& digit: levelDesc.mDigits) {
+    if (at(digit.mCell) & nFixtureOnCell) {
+      return fail("Digit is on top of an emitter or sink.");
+    }
+  }
+  for (const Requirement& requirement: levelDesc.mRequirements) {
+    if (at(requirement.mCell) & nFixtureOnCell) {
+      return fail("Requirement is on top of an emitter or sink.");
+    }
+  }
+  for (int i = 0; i < (int)cells.size(); ++i) {
+    if ((cells[i] & nLockedModifierOnCell) && (cells[i] & nFixtureOnCell)) {
+      return fail("Locked modifier is on top of an emitter or sink.");
+    }
+  }
+  return true;
+}
+
+bool ValidLevelDesc(const LevelDesc& levelDesc, std::string* error) {
+  if (!ValidFieldSize(levelDesc.mWidth, levelDesc.mHeight)) {
+    *error = "The field must have a positive size of at most " +
+      std::to_string(nMaxFieldCells) + " cells.";
+    return false;
+  }
+  bool validElements = ValidateElements(
+    ViewLevelDesc(levelDesc),
+    levelDesc.mWidth,
+    levelDesc.mHeight,
+    [error](const char* message) {
+      *error = message;
+    });
+  return validElements && ValidSharedCells(levelDesc, error);
+}
+
+bool FixedDigits(const LevelDesc& levelDesc) {
+  return levelDesc.mEmitters.empty() && levelDesc.mSinks.empty();
+}
+
+int PlaceableCount(const LevelDesc& levelDesc) {
+  int count = 0;
+  for (const Filter& filter: levelDesc.mFilters) {
+    count += filter.mPlaceable;
+  }
+  for (const Shifter& shifter: levelDesc.mShifters) {
+    count += shifter.mPlaceable;
+  }
+  return count;
+}
+
+std::vector<int> PlaceableModifiers(const LevelDesc& levelDesc) {
+  std::vector<int> modifiers;
+  int filterCount = (int)levelDesc.mFilters.size();
+  for (int i = 0; i < filterCount; ++i) {
+    if (levelDesc.mFilters[i].mPlaceable) {
+      modifiers.push_back(i);
+    }
+  }
+  for (int i = 0; i < (int)levelDesc.mShifters.size(); ++i) {
+    if (levelDesc.mShifters[i].mPlaceable) {
+      modifiers.push_back(filterCount + i);
+    }
+  }
+  return modifiers;
+}
+
+void Board::Init(const LevelDesc& levelDesc) {
+  mLevel = &levelDesc;
+  mModifiers.assign(CellCount(), nNoModifier);
+  mCellDescs.assign(CellCount(), nEmptyCellDesc);
+  mReserved.assign(CellCount(), false);
+  int filterCount = (int)levelDesc.mFilters.size();
+  for (int i = 0; i < filterCount; ++i) {
+    const Filter& filter = levelDesc.mFilters[i];
+    if (!filter.mPlaceable) {
+      SetModifier(CellIndex(filter.mStartCell), i);
+    }
+  }
+  for (int i = 0; i < (int)levelDesc.mShifters.size(); ++i) {
+    const Shifter& shifter = levelDesc.mShifters[i];
+    if (!shifter.mPlaceable) {
+      SetModifier(CellIndex(shifter.mStartCell), filterCount + i);
+    }
+  }
+  for (const Digit& digit: levelDesc.mDigits) {
+    mReserved[CellIndex(digit.mCell)] = true;
+  }
+  for (const Requirement& requirement: levelDesc.mRequirements) {
+    mReserved[CellIndex(requirement.mCell)] = true;
+  }
+  for (const Emitter& emitter: levelDesc.mEmitters) {
+    mReserved[CellIndex(emitter.mCell)] = true;
+  }
+  for (const Sink& sink: levelDesc.mSinks) {
+    mReserved[CellIndex(sink.mCell)] = true;
+    mCellDescs[CellIndex(sink.mCell)] = nSinkCellDesc;
+  }
+}
+
+bool Board::Init(const LevelDesc& levelDesc, const Placement& placement) {
+  Init(levelDesc);
+  std::vector<int> placeableModifiers = PlaceableModifiers(levelDesc);
+  if (placement.size() != placeableModifiers.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < placement.size(); ++i) {
+    int cell = placement[i];
+    if (cell == nNoCell) {
+      continue;
+    }
+    if (cell < 0 || cell >= CellCount() || !Placeable(cell)) {
+      return false;
+    }
+    SetModifier(cell, placeableModifiers[i]);
+  }
+  return true;
+}
+
+bool Board::Placeable(int cell) const {
+  return !mReserved[cell] && mModifiers[cell] == nNoModifier;
+}
+
+int Board::CellIndex(const int cell[2]) const {
+  return cell[1] * mLevel->mWidth + cell[0];
+}
+
+int Board::CellCount() const {
+  return (int)((int64_t)mLevel->mWidth * mLevel->mHeight);
+}
+
+void Board::SetModifier(int cell, int modifier) {
+  mModifiers[cell] = modifier;
+  int filterCount = (int)mLevel->mFilters.size();
+  if (modifier == nNoModifier) {
+    mCellDescs[cell] = nEmptyCellDesc;
+  }
+  else if (modifier < filterCount) {
+    mCellDescs[cell] = FilterCellDesc(mLevel->mFilters[modifier]);
+  }
+  else {
+    mCellDescs[cell] =
+      ShifterCellDesc(mLevel->mShifters[modifier - filterCount]);
+  }
+}
+
+void Simulation::Reset(const Board& board) {
+  mBoard = &board;
+  mDigits.assign(board.mLevel->mDigits.begin(), board.mLevel->mDigits.end());
+  mLive.assign(mDigits.size(), true);
+  mFreeSlots.clear();
+  mLiveCount = (int)mDigits.size();
+  mDigitLayer.assign(board.CellCount(), nNoDigit);
+  for (int i = 0; i < (int)mDigits.size(); ++i) {
+    mDigitLayer[board.CellIndex(mDigits[i].mCell)] = i;
+  }
+  mTick = 0;
+  Emit();
+}
+
+void Simulation::Step() {
+  const LevelDesc& level = *mBoard->mLevel;
+  const CellDesc* cellDescs = mBoard->mCellDescs.data();
+  for (int i = 0; i < (int)mDigits.size(); ++i) {
+    if (!mLive[i]) {
+      continue;
+    }
+    Digit& digit = mDigits[i];
+    mDigitLayer[mBoard->CellIndex(digit.mCell)] = nNoDigit;
+    switch (digit.mDirection) {
+    case Direction::Up: digit.mCell[1] += 1; break;
+    case Direction::Right: digit.mCell[0] += 1; break;
+    case Direction::Down: digit.mCell[1] -= 1; break;
+    case Direction::Left: digit.mCell[0] -= 1; break;
+    }
+    digit.mCell[0] = std::clamp(digit.mCell[0], 0, level.mWidth - 1);
+    digit.mCell[1] = std::clamp(digit.mCell[1], 0, level.mHeight - 1);
+    int cell = mBoard->CellIndex(digit.mCell);
+    mDigitLayer[cell] = i;
+
+    CellDesc desc = cellDescs[cell];
+    switch (DescKind(desc)) {
+    case CellKind::Empty: break;
+    case CellKind::Filter:
+      digit.mValue = DescFilter(desc, digit.mValue);
+      break;
+    case CellKind::Shifter: digit.mDirection = DescDirection(desc); break;
+    case CellKind::Sink: Despawn(i); break;
+    }
+  }
+  ++mTick;
+  // New digits only move from the next step on.
+  Emit();
+}
+
+void Simulation::Emit() {
+  for (const Emitter& emitter: mBoard->mLevel->mEmitters) {
+    if (mTick % emitter.mPeriod == 0) {
+      Spawn({
+        {emitter.mCell[0], emitter.mCell[1]},
+        emitter.mValue,
+        emitter.mDirection});
+    }
+  }
+}
+
+int Simulation::Spawn(const Digit& digit) {
+  int digitIdx;
+  if (mFreeSlots.empty()) {
+    digitIdx = (int)mDigits.size();
+    mDigits.push_back(digit);
+    mLive.push_back(true);
+  }
+  else {
+    digitIdx = mFreeSlots.back();
+    mFreeSlots.pop_back();
+    mDigits[digitIdx] = digit;
+    mLive[digitIdx] = true;
+  }
+  ++mLiveCount;
+  mDigitLayer[mBoard->CellIndex(digit.mCell)] = digitIdx;
+  return digitIdx;
+}
+
+void Simulation::Despawn(int digitIdx) {
+  int cell = mBoard->CellIndex(mDigits[digitIdx].mCell);
+  if (mDigitLayer[cell] == digitIdx) {
+    mDigitLayer[cell] = nNoDigit;
+  }
+  mLive[digitIdx] = false;
+  mFreeSlots.push_back(digitIdx);
+  --mLiveCount;
+}
+
+bool Simulation::RequirementsMet() const {
+  for (const Requirement& requirement: mBoard->mLevel->mRequirements) {
+    int digitIdx = mDigitLayer[mBoard->CellIndex(requirement.mCell)];
+    if (digitIdx == nNoDigit) {
+      return false;
+    }
+    if (mDigits[digitIdx].mValue != requirement.mValue) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Simulation::Settled() const {
+  const LevelDesc& level = *mBoard->mLevel;
+  if (!level.mEmitters.empty()) {
+    return false;
+  }
+  for (int i = 0; i < (int)mDigits.size(); ++i) {
+    if (!mLive[i]) {
+      continue;
+    }
+    const Digit& digit = mDigits[i];
+    bool againstWall = false;
+    switch (digit.mDirection) {
+    case Direction::Up:
+      againstWall = digit.mCell[1] == level.mHeight - 1;
+      break;
+    case Direction::Right:
+      againstWall = digit.mCell[0] == level.mWidth - 1;
+      break;
+    case Direction::Down: againstWall = digit.mCell[1] == 0; break;
+    case Direction::Left: againstWall = digit.mCell[0] == 0; break;
+    }
+    // A digit stuck against a wall on a modifier is still modified every step.
+    if (
+      !againstWall ||
+      mBoard->mModifiers[mBoard->CellIndex(digit.mCell)] != nNoModifier) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Simulation::Repeats(const Simulation& saved) const {
+  if (
+    saved.mDigits.size() != mDigits.size() || saved.mLive != mLive ||
+    saved.mFreeSlots != mFreeSlots) {
+    return false;
+  }
+  // Emitters have to be at the same point in their periods too.
+  for (const Emitter& emitter: mBoard->mLevel->mEmitters) {
+    if (mTick % emitter.mPeriod != saved.mTick % emitter.mPeriod) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < mDigits.size(); ++i) {
+    if (!mLive[i]) {
+      continue;
+    }
+    const Digit& digit = mDigits[i];
+    const Digit& savedDigit = saved.mDigits[i];
+    if (
+      !SameCell(digit.mCell, savedDigit.mCell) ||
+      digit.mValue != savedDigit.mValue ||
+      digit.mDirection != savedDigit.mDirection) {
+      return false;
+    }
+  }
+  return mDigitLayer == saved.mDigitLayer;
+}
+
+void Simulation::SaveState(Simulation* saved) const {
+  saved->mDigits = mDigits;
+  saved->mLive = mLive;
+  saved->mFreeSlots = mFreeSlots;
+  saved->mDigitLayer = mDigitLayer;
+  saved->mTick = mTick;
+}
+
+RunResult Run(Simulation& simulation, const Board& board, int maxTicks) {
+  simulation.Reset(board);
+  // The digit layer can still change on the step after every digit comes to
+  // rest, so the run ends once it was settled for two steps in a row. Digits
+  // that bounce between shifters never settle, so the state is also saved at
+  // every power of two tick and the run ends once it comes back to it.
+  bool settled = false;
+  Simulation saved = {};
+  while (simulation.mTick < maxTicks) {
+    simulation.Step();
+    if (simulation.RequirementsMet()) {
+      return {true, simulation.mTick, true};
+    }
+    bool prevSettled = settled;
+    settled = simulation.Settled();
+    if ((settled && prevSettled) || simulation.Repeats(saved)) {
+      return {false, simulation.mTick, true};
+    }
+    if ((simulation.mTick & (simulation.mTick - 1)) == 0) {
+      simulation.SaveState(&saved);
+    }
+  }
+  return {false, simulation.mTick, false};
+}
+
+void DirectionDelta(Direction direction, int delta[2]) {
+  delta[0] = 0;
+  delta[1] = 0;
+  switch (direction) {
+  case Direction::Up: delta[1] = 1; break;
+  case Direction::Right: delta[0] = 1; break;
+  case Direction::Down: delta[1] = -1; break;
+  case Direction::Left: delta[0] = -1; break;
+  }
+}
+
+bool EventSimulation::Event::operator>(const Event& other) const {
+  if (mTick != other.mTick) {
+    return mTick > other.mTick;
+  }
+  return mDigitIdx > other.mDigitIdx;
+}
+
+void EventSimulation::Reset(const Board& board) {
+  mBoard = &board;
+  const LevelDesc& level = *board.mLevel;
+  mRequirementCells.assign(board.CellCount(), false);
+  for (const Requirement& requirement: level.mRequirements) {
+    mRequirementCells[board.CellIndex(requirement.mCell)] = true;
+  }
+
+  // Each direction is filled starting from the wall it points at, so a cell's
+  // neighbour along the direction is always done first.
+  mStopDistance.assign(board.CellCount() * 4, 0);
+  for (int d = 0; d < 4; ++d) {
+    int delta[2];
+    DirectionDelta((Direction)d, delta);
+    for (int i = 0; i < level.mHeight; ++i) {
+      int y = delta[1] > 0 ? level.mHeight - 1 - i : i;
+      for (int j = 0; j < level.mWidth; ++j) {
+        int x = delta[0] > 0 ? level.mWidth - 1 - j : j;
+        int next[2] = {x + delta[0], y + delta[1]};
+        if (!CellInField(next, level.mWidth, level.mHeight)) {
+          continue;
+        }
+        int nextIdx = board.CellIndex(next);
+        int distance = 1;
+        bool stop = board.mModifiers[nextIdx] != nNoModifier ||
+          mRequirementCells[nextIdx];
+        if (!stop) {
+          int nextDistance = mStopDistance[nextIdx * 4 + d];
+          distance = nextDistance > 0 ? nextDistance + 1 : 0;
+        }
+        mStopDistance[(y * level.mWidth + x) * 4 + d] = distance;
+      }
+    }
+  }
+
+  mTravellers.clear();
+  for (const Digit& digit: level.mDigits) {
+    Traveller traveller;
+    traveller.mCell[0] = traveller.mPrevCell[0] = digit.mCell[0];
+    traveller.mCell[1] = traveller.mPrevCell[1] = digit.mCell[1];
+    traveller.mTick = 0;
+    traveller.mValue = digit.mValue;
+    traveller.mDirection = digit.mDirection;
+    mTravellers.push_back(traveller);
+  }
+  mEvents.clear();
+  for (int i = 0; i < (int)mTravellers.size(); ++i) {
+    Schedule(i);
+  }
+  // Digits that never move can meet requirements without any events.
+  mChecks.clear();
+  PushCheck(1);
+  PushCheck(2);
+  mTick = 0;
+}
+
+int EventSimulation::NextTick() const {
+  int tick = smNever;
+  if (!mEvents.empty()) {
+    tick = mEvents.front().mTick;
+  }
+  if (!mChecks.empty()) {
+    tick = std::min(tick, mChecks.front());
+  }
+  return tick;
+}
+
+bool EventSimulation::AdvanceTo(int tick) {
+  while (NextTick() <= tick) {
+    mTick = NextTick();
+    while (!mEvents.empty() && mEvents.front().mTick == mTick) {
+      std::pop_heap(mEvents.begin(), mEvents.end(), std::greater<Event>());
+      Event event = mEvents.back();
+      mEvents.pop_back();
+      ProcessEvent(event);
+    }
+    bool check = false;
+    while (!mChecks.empty() && mChecks.front() == mTick) {
+      std::pop_heap(mChecks.begin(), mChecks.end(), std::greater<int>());
+      mChecks.pop_back();
+      check = true;
+    }
+    if (check && RequirementsMet()) {
+      return true;
+    }
+  }
+  mTick = tick;
+  return false;
+}
+
+void EventSimulation::ProcessEvent(const Event& event) {
+  Traveller& traveller = mTravellers[event.mDigitIdx];
+  int prevCell[2], cell[2];
+  DigitCell(event.mDigitIdx, event.mTick - 1, prevCell);
+  DigitCell(event.mDigitIdx, event.mTick, cell);
+  traveller.mPrevCell[0] = prevCell[0];
+  traveller.mPrevCell[1] = prevCell[1];
+  traveller.mCell[0] = cell[0];
+  traveller.mCell[1] = cell[1];
+  traveller.mTick = event.mTick;
+
+  int cellIdx = mBoard->CellIndex(cell);
+  CellDesc desc = mBoard->mCellDescs[cellIdx];
+  if (DescKind(desc) == CellKind::Filter) {
+    traveller.mValue = DescFilter(desc, traveller.mValue);
+  }
+  else if (DescKind(desc) == CellKind::Shifter) {
+    traveller.mDirection = DescDirection(desc);
+  }
+  if (mRequirementCells[cellIdx]) {
+    PushCheck(event.mTick);
+    PushCheck(event.mTick + 1);
+    PushCheck(event.mTick + 2);
+  }
+  Schedule(event.mDigitIdx);
+}
+
+void EventSimulation::PushEvent(int tick, int digitIdx) {
+  mEvents.push_back({tick, digitIdx});
+  std::push_heap(mEvents.begin(), mEvents.end(), std::greater<Event>());
+}
+
+void EventSimulation::PushCheck(int tick) {
+  mChecks.push_back(tick);
+  std::push_heap(mChecks.begin(), mChecks.end(), std::greater<int>());
+}
+
+void EventSimulation::Schedule(int digitIdx) {
+  const Traveller& traveller = mTravellers[digitIdx];
+  int cellIdx = mBoard->CellIndex(traveller.mCell);
+  int distance = mStopDistance[cellIdx * 4 + (int)traveller.mDirection];
+  if (distance > 0) {
+    PushEvent(traveller.mTick + distance, digitIdx);
+    return;
+  }
+  // A digit held against a wall on a modifier arrives at it every tick.
+  int delta[2];
+  DirectionDelta(traveller.mDirection, delta);
+  int next[2] = {traveller.mCell[0] + delta[0], traveller.mCell[1] + delta[1]};
+  const LevelDesc& level = *mBoard->mLevel;
+  bool againstWall = !CellInField(next, level.mWidth, level.mHeight);
+  if (againstWall && mBoard->mModifiers[cellIdx] != nNoModifier) {
+    PushEvent(traveller.mTick + 1, digitIdx);
+  }
+}
+
+void EventSimulation::DigitCell(int digitIdx, int tick, int cell[2]) const {
+  const Traveller& traveller = mTravellers[digitIdx];
+  if (tick < traveller.mTick) {
+    cell[0] = traveller.mPrevCell[0];
+    cell[1] = traveller.mPrevCell[1];
+    return;
+  }
+  int delta[2];
+  DirectionDelta(traveller.mDirection, delta);
+  int steps = tick - traveller.mTick;
+  const LevelDesc& level = *mBoard->mLevel;
+  cell[0] =
+    std::clamp(traveller.mCell[0] + delta[0] * steps, 0, level.mWidth - 1);
+  cell[1] =
+    std::clamp(traveller.mCell[1] + delta[1] * steps, 0, level.mHeight - 1);
+}
+
+bool EventSimulation::TouchesCell(int digitIdx, int cellIdx) const {
+  int cell[2];
+  DigitCell(digitIdx, mTick - 1, cell);
+  if (mBoard->CellIndex(cell) == cellIdx) {
+    return true;
+  }
+  DigitCell(digitIdx, mTick, cell);
+  return mBoard->CellIndex(cell) == cellIdx;
+}
+
+bool EventSimulation::RequirementsMet() const {
+  // During a step every digit clears the layer at its old cell and then writes
+  // its new cell. So the last digit in order that was on a cell before or
+  // after the step decides what the layer holds there.
+  for (const Requirement& requirement: mBoard->mLevel->mRequirements) {
+    int cellIdx = mBoard->CellIndex(requirement.mCell);
+    int digitIdx = (int)mTravellers.size() - 1;
+    while (digitIdx >= 0 && !TouchesCell(digitIdx, cellIdx)) {
+      --digitIdx;
+    }
+    if (digitIdx < 0) {
+      return false;
+    }
+    int cell[2];
+    DigitCell(digitIdx, mTick, cell);
+    if (mBoard->CellIndex(cell) != cellIdx) {
+      return false;
+    }
+    if (mTravellers[digitIdx].mValue != requirement.mValue) {
+      return false;
+    }
+  }
+  return true;
+}
+
+RunResult Run(EventSimulation& simulation, const Board& board, int maxTicks) {
+  simulation.Reset(board);
+  while (simulation.NextTick() <= maxTicks) {
+    if (simulation.AdvanceTo(simulation.NextTick())) {
+      return {true, simulation.mTick, true};
+    }
+  }
+  bool decided = simulation.NextTick() == EventSimulation::smNever;
+  return {false, simulation.mTick, decided};
+}
+
+int DefaultMaxTicks(const LevelDesc& levelDesc) {
+  return (int)(4 * (int64_t)levelDesc.mWidth * levelDesc.mHeight);
+}
+
+} // namespace Sim
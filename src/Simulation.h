@@ -0,0 +1,242 @@
+#ifndef Simulation_h
+#define Simulation_h
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Level.h"
+
+// A headless version of the automata. It has no dependency on the engine, so
+// tools that only need answers about levels (the solver daemon, checks) can
+// run it without a window or a World.
+namespace Sim {
+
+constexpr int nNoCell = -1;
+constexpr int nNoDigit = -1;
+constexpr int nNoModifier = -1;
+
+// What a step needs to know about a cell, packed into a byte so it never has
+// to follow a modifier id into the level. The low two bits hold the kind.
+// Filters keep their type in the next two bits and their operand in the high
+// four. Shifters keep their direction in the next two bits.
+typedef uint8_t CellDesc;
+enum class CellKind { Empty, Filter, Shifter, Sink };
+constexpr CellDesc nEmptyCellDesc = (CellDesc)CellKind::Empty;
+constexpr CellDesc nSinkCellDesc = (CellDesc)CellKind::Sink;
+
+// Digits are always single digits, so the filter operand only matters modulo
+// 10, or up to 10 for Mod, and fits in four bits.
+constexpr int ReducedOperand(const Filter& filter) {
+  if (filter.mType == Filter::Type::Mod) {
+    int operand = filter.mValue < 0 ? -filter.mValue : filter.mValue;
+    return operand < 10 ? operand : 10;
+  }
+  return (filter.mValue % 10 + 10) % 10;
+}
+
+constexpr CellDesc FilterCellDesc(const Filter& filter) {
+  return (CellDesc)(
+    (int)CellKind::Filter | (int)filter.mType << 2 |
+    ReducedOperand(filter) << 4);
+}
+
+constexpr CellDesc ShifterCellDesc(const Shifter& shifter) {
+  return (CellDesc)((int)CellKind::Shifter | (int)shifter.mDirection << 2);
+}
+
+constexpr CellKind DescKind(CellDesc desc) {
+  return (CellKind)(desc & 3);
+}
+
+constexpr Direction DescDirection(CellDesc desc) {
+  return (Direction)(desc >> 2 & 3);
+}
+
+// The value a digit leaves a filter cell with for every filter descriptor,
+// indexed by the descriptor without its kind bits, and every digit value.
+struct FilterTable {
+  uint8_t mResults[64][10];
+};
+constexpr FilterTable MakeFilterTable() {
+  FilterTable table = {};
+  for (int i = 0; i < 64; ++i) {
+    Filter filter = {{-1, -1}, i >> 2, (Filter::Type)(i & 3), false};
+    for (int value = 0; value < 10; ++value) {
+      // Mod 0 never reaches a board.
+      bool valid = filter.mType != Filter::Type::Mod || filter.mValue != 0;
+      table.mResults[i][value] =
+        (uint8_t)(valid ? ApplyFilter(filter, value) : value);
+    }
+  }
+  return table;
+}
+inline constexpr FilterTable nFilterTable = MakeFilterTable();
+
+constexpr int DescFilter(CellDesc desc, int value) {
+  return nFilterTable.mResults[desc >> 2][value];
+}
+
+// The most cells a level's field can have. Every per-cell array of a level is
+// bounded by it, however large a field a request asks for, and cell indices
+// stay well within an int.
+constexpr int64_t nMaxFieldCells = 1 << 20;
+// Whether a field is non-empty and has at most nMaxFieldCells cells.
+bool ValidFieldSize(int width, int height);
+
+// A level that owns its data and can have any field size up to
+// nMaxFieldCells. Built in levels
+// convert to one and level descriptions read at runtime are parsed into one.
+struct LevelDesc {
+  int mWidth;
+  int mHeight;
+  std::vector<Digit> mDigits;
+  std::vector<Requirement> mRequirements;
+  std::vector<Filter> mFilters;
+  std::vector<Shifter> mShifters;
+  std::vector<Emitter> mEmitters;
+  std::vector<Sink> mSinks;
+};
+LevelDesc MakeLevelDesc(const Level& level);
+Level ViewLevelDesc(const LevelDesc& levelDesc);
+bool ValidLevelDesc(const LevelDesc& levelDesc, std::string* error);
+// Whether the digits of a run are exactly the level's digits, i.e. it has no
+// emitters or sinks. EventSimulation only supports these levels.
+bool FixedDigits(const LevelDesc& levelDesc);
+
+// A placement holds one cell index per placeable modifier. The placeable
+// filters come first followed by the placeable shifters, both in level order.
+// nNoCell leaves a placeable in the palette.
+typedef std::vector<int> Placement;
+int PlaceableCount(const LevelDesc& levelDesc);
+// Returns the modifier id (see Board::mModifiers) of every placeable.
+std::vector<int> PlaceableModifiers(const LevelDesc& levelDesc);
+
+// The modifiers on the field for one placement.
+struct Board {
+  // Sets up the locked modifiers only.
+  void Init(const LevelDesc& levelDesc);
+  // Also places the placement. Returns false when the placement puts a
+  // modifier somewhere the game wouldn't allow.
+  bool Init(const LevelDesc& levelDesc, const Placement& placement);
+  // Whether the game lets a placeable go on a cell of an otherwise empty board.
+  bool Placeable(int cell) const;
+  int CellIndex(const int cell[2]) const;
+  int CellCount() const;
+  // Every change to mModifiers goes through here to keep mCellDescs in sync.
+  void SetModifier(int cell, int modifier);
+
+  const LevelDesc* mLevel;
+  // For every cell, nNoModifier, the index of its filter, or the filter count
+  // plus the index of its shifter.
+  std::vector<int> mModifiers;
+  // The same cells as the steps see them, which also marks the sinks.
+  std::vector<CellDesc> mCellDescs;
+  // Cells that start with a digit or hold a requirement, emitter or sink.
+  std::vector<bool> mReserved;
+};
+
+struct Simulation {
+  void Reset(const Board& board);
+  void Step();
+  // Puts a digit in a free slot and on the digit layer. Returns its slot.
+  int Spawn(const Digit& digit);
+  void Despawn(int digitIdx);
+  // Matches the game's check, which reads the digit layer after a step.
+  bool RequirementsMet() const;
+  // True when no digit can ever change again.
+  bool Settled() const;
+  // Whether the state matches one saved by SaveState. From then on the run
+  // repeats itself, so it can never meet requirements it hasn't met yet.
+  bool Repeats(const Simulation& saved) const;
+  void SaveState(Simulation* saved) const;
+
+  const Board* mBoard;
+  // Digits live in slots that never move. The level's digits take the first
+  // slots in level order. A despawned digit's slot goes on mFreeSlots and the
+  // next spawn takes it back, so both are O(1) however many digits are live.
+  // A step moves the live digits in slot order.
+  std::vector<Digit> mDigits;
+  std::vector<bool> mLive;
+  std::vector<int> mFreeSlots;
+  int mLiveCount;
+  // For every cell, the digit the game's digit layer would hold.
+  std::vector<int> mDigitLayer;
+  int mTick;
+
+private:
+  void Emit();
+};
+
+// An engine mode that only does work when something can happen. Every digit
+// has a tick at which it next reaches a modifier or requirement. Those events
+// are kept in a priority queue and the simulation jumps from one to the next.
+// Between events a digit travels in a straight line, so its cell at any tick
+// comes from the cell and tick of its last event. Walls are handled by the
+// same clamp the step engine uses. The cost is O(events) instead of
+// O(ticks * digits).
+struct EventSimulation {
+  void Reset(const Board& board);
+  // The next tick with an event or requirement check, or smNever.
+  int NextTick() const;
+  // Processes every event and check up to and including the tick. When the
+  // requirements are met along the way, this stops at that tick and returns
+  // true.
+  bool AdvanceTo(int tick);
+  // Matches the game's check at mTick.
+  bool RequirementsMet() const;
+  // The cell a digit occupies at any tick from mTick up to its next event.
+  void DigitCell(int digitIdx, int tick, int cell[2]) const;
+
+  static constexpr int smNever = 0x7fffffff;
+
+  struct Event {
+    int mTick;
+    int mDigitIdx;
+    bool operator>(const Event& other) const;
+  };
+  struct Traveller {
+    // Where and when the digit last changed course.
+    int mCell[2];
+    int mTick;
+    int mValue;
+    Direction mDirection;
+    // The cell before the last event, needed to reproduce the digit layer.
+    int mPrevCell[2];
+  };
+
+  const Board* mBoard;
+  std::vector<Traveller> mTravellers;
+  // Both are min heaps. They are plain vectors so a reset keeps their memory.
+  std::vector<Event> mEvents;
+  // Ticks at which the requirements have to be checked. A digit arriving on a
+  // requirement cell can change the check on that tick and the two after it.
+  std::vector<int> mChecks;
+  // For every cell and direction, the number of steps to the next cell holding
+  // a modifier or requirement, or 0 when a wall comes first.
+  std::vector<int> mStopDistance;
+  std::vector<bool> mRequirementCells;
+  int mTick;
+
+private:
+  void PushEvent(int tick, int digitIdx);
+  void PushCheck(int tick);
+  void Schedule(int digitIdx);
+  void ProcessEvent(const Event& event);
+  bool TouchesCell(int digitIdx, int cellIdx) const;
+};
+
+struct RunResult {
+  bool mSolved;
+  int mTick;
+  // False when maxTicks cut the run off before it solved, settled, repeated
+  // itself or ran out of events, so it might still solve later.
+  bool mDecided;
+};
+RunResult Run(Simulation& simulation, const Board& board, int maxTicks);
+RunResult Run(EventSimulation& simulation, const Board& board, int maxTicks);
+int DefaultMaxTicks(const LevelDesc& levelDesc);
+
+} // namespace Sim
+
+#endif
@@ -0,0 +1,812 @@
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <thread>
+
+#include "Reachability.h"
+#include "Solver.h"
+
+namespace Solver {
+
+TranspositionCache::TranspositionCache(size_t capacity):
+  mShardCapacity(std::max<size_t>(1, capacity / smShardCount)),
+  mHits(0),
+  mMisses(0) {}
+
+bool TranspositionCache::Find(uint64_t key, Sim::RunResult* result) {
+  Shard& shard = mShards[key % smShardCount];
+  std::lock_guard<std::mutex> lock(shard.mMutex);
+  auto it = shard.mResults.find(key);
+  if (it == shard.mResults.end()) {
+    mMisses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  mHits.fetch_add(1, std::memory_order_relaxed);
+  *result = it->second;
+  return true;
+}
+
+void TranspositionCache::Insert(uint64_t key, const Sim::RunResult& result) {
+  Shard& shard = mShards[key % smShardCount];
+  std::lock_guard<std::mutex> lock(shard.mMutex);
+  if (shard.mResults.size() >= mShardCapacity) {
+    shard.mResults.clear();
+  }
+  shard.mResults[key] = result;
+}
+
+// FNV-1a over the ints that describe a level or placement.
+constexpr uint64_t nHashBasis = 14695981039346656037ull;
+void HashInt(uint64_t& hash, int value) {
+  for (int i = 0; i < 4; ++i) {
+    hash ^= (uint64_t)((value >> (i * 8)) & 0xff);
+    hash *= 1099511628211ull;
+  }
+}
+
+uint64_t HashLevelDesc(const Sim::LevelDesc& levelDesc, int maxTicks) {
+  uint64_t hash = nHashBasis;
+  HashInt(hash, levelDesc.mWidth);
+  HashInt(hash, levelDesc.mHeight);
+  HashInt(hash, maxTicks);
+  HashInt(hash, (int)levelDesc.mDigits.size());
+  for (const Digit& digit: levelDesc.mDigits) {
+    HashInt(hash, digit.mCell[0]);
+    HashInt(hash, digit.mCell[1]);
+    HashInt(hash, digit.mValue);
+    HashInt(hash, (int)digit.mDirection);
+  }
+  HashInt(hash, (int)levelDesc.mRequirements.size());
+  for (const Requirement& requirement: levelDesc.mRequirements) {
+    HashInt(hash, requirement.mCell[0]);
+    HashInt(hash, requirement.mCell[1]);
+    HashInt(hash, requirement.mValue);
+  }
+  HashInt(hash, (int)levelDesc.mFilters.size());
+  for (const Filter& filter: levelDesc.mFilters) {
+    HashInt(hash, filter.mPlaceable ? -1 : filter.mStartCell[0]);
+    HashInt(hash, filter.mPlaceable ? -1 : filter.mStartCell[1]);
+    HashInt(hash, filter.mValue);
+    HashInt(hash, (int)filter.mType);
+    HashInt(hash, filter.mPlaceable);
+  }
+  HashInt(hash, (int)levelDesc.mShifters.size());
+  for (const Shifter& shifter: levelDesc.mShifters) {
+    HashInt(hash, shifter.mPlaceable ? -1 : shifter.mStartCell[0]);
+    HashInt(hash, shifter.mPlaceable ? -1 : shifter.mStartCell[1]);
+    HashInt(hash, (int)shifter.mDirection);
+    HashInt(hash, shifter.mPlaceable);
+  }
+  HashInt(hash, (int)levelDesc.mEmitters.size());
+  for (const Emitter& emitter: levelDesc.mEmitters) {
+    HashInt(hash, emitter.mCell[0]);
+    HashInt(hash, emitter.mCell[1]);
+    HashInt(hash, emitter.mValue);
+    HashInt(hash, (int)emitter.mDirection);
+    HashInt(hash, emitter.mPeriod);
+  }
+  HashInt(hash, (int)levelDesc.mSinks.size());
+  for (const Sink& sink: levelDesc.mSinks) {
+    HashInt(hash, sink.mCell[0]);
+    HashInt(hash, sink.mCell[1]);
+  }
+  return hash;
+}
+
+uint64_t HashPlacement(uint64_t levelHash, const Sim::Placement& placement) {
+  uint64_t hash = levelHash;
+  for (int cell: placement) {
+    HashInt(hash, cell);
+  }
+  return hash;
+}
+
+std::vector<int> IdenticalGroups(const Sim::LevelDesc& levelDesc) {
+  std::vector<int> modifiers = Sim::PlaceableModifiers(levelDesc);
+  int filterCount = (int)levelDesc.mFilters.size();
+  auto identical = [&](int modifierA, int modifierB) {
+    if ((modifierA < filterCount) != (modifierB < filterCount)) {
+      return false;
+    }
+    if (modifierA < filterCount) {
+      const Filter& filterA = levelDesc.mFilters[modifierA];
+      const Filter& filterB = levelDesc.mFilters[modifierB];
+      return filterA.mType == filterB.mType && filterA.mValue == filterB.mValue;
+    }
+    const Shifter& shifterA = levelDesc.mShifters[modifierA - filterCount];
+    const Shifter& shifterB = levelDesc.mShifters[modifierB - filterCount];
+    return shifterA.mDirection == shifterB.mDirection;
+  };
+
+  std::vector<int> groups(modifiers.size());
+  for (size_t i = 0; i < modifiers.size(); ++i) {
+    groups[i] = (int)i;
+    for (size_t j = 0; j < i; ++j) {
+      if (identical(modifiers[i], modifiers[j])) {
+        groups[i] = groups[j];
+        break;
+      }
+    }
+  }
+  return groups;
+}
+
+void Search::Init(
+  const Sim::LevelDesc& levelDesc,
+  const Sim::Placement& partial,
+  int maxTicks,
+  TranspositionCache* cache,
+  Stats* stats,
+  const std::atomic<bool>* cancel) {
+  mLevel = &levelDesc;
+  mMaxTicks = maxTicks;
+  mLevelHash = HashLevelDesc(levelDesc, maxTicks);
+  mPrune = true;
+  mCache = cache;
+  mStats = stats;
+  mCancel = cancel;
+
+  std::vector<int> groups = IdenticalGroups(levelDesc);
+  mPrevIdentical.assign(partial.size(), -1);
+  for (size_t i = 0; i < partial.size(); ++i) {
+    if (partial[i] != nFreeCell) {
+      continue;
+    }
+    for (int j = (int)i - 1; j >= 0; --j) {
+      if (partial[j] == nFreeCell && groups[j] == groups[i]) {
+        mPrevIdentical[i] = j;
+        break;
+      }
+    }
+  }
+}
+
+// Sets up a board with every fixed cell of a partial placement placed.
+void InitPartialBoard(
+  Sim::Board& board,
+  const Sim::LevelDesc& levelDesc,
+  const Sim::Placement& partial) {
+  board.Init(levelDesc);
+  std::vector<int> placeableModifiers = Sim::PlaceableModifiers(levelDesc);
+  for (size_t i = 0; i < partial.size(); ++i) {
+    if (partial[i] >= 0) {
+      board.SetModifier(partial[i], placeableModifiers[i]);
+    }
+  }
+}
+
+double Choose(int n, int k) {
+  if (k < 0 || k > n) {
+    return 0.0;
+  }
+  double count = 1.0;
+  for (int i = 0; i < k; ++i) {
+    count = count * (n - i) / (i + 1);
+  }
+  return count;
+}
+
+// The number of completions of a partial placement that Enumerate visits,
+// given a board with its fixed cells placed. The free placeables of a group of
+// identical ones take the palette first and then cells in increasing order. A
+// group whose previous member already holds a cell must place the rest after
+// it. Those groups choose from nested ranges of cells, so they are counted
+// from the narrowest range out, and the groups that may use the palette share
+// whatever cells are left.
+uint64_t CompletionCount(
+  const Search& search,
+  const Sim::Board& board,
+  const Sim::Placement& partial) {
+  std::vector<int> cells;
+  for (int cell = 0; cell < board.CellCount(); ++cell) {
+    if (board.Placeable(cell)) {
+      cells.push_back(cell);
+    }
+  }
+  struct Group {
+    int mCount;
+    // The cell the group's placeables must come after or Sim::nNoCell when
+    // they may use the palette.
+    int mAfter;
+  };
+  std::vector<Group> groups;
+  std::vector<int> groupIdx(partial.size(), -1);
+  for (size_t i = 0; i < partial.size(); ++i) {
+    if (partial[i] != nFreeCell) {
+      continue;
+    }
+    int prevIdentical = search.mPrevIdentical[i];
+    if (prevIdentical != -1 && partial[prevIdentical] == nFreeCell) {
+      groupIdx[i] = groupIdx[prevIdentical];
+      ++groups[groupIdx[i]].mCount;
+      continue;
+    }
+    groupIdx[i] = (int)groups.size();
+    groups.push_back(
+      {1, prevIdentical == -1 ? Sim::nNoCell : partial[prevIdentical]});
+  }
+  std::sort(groups.begin(), groups.end(), [](const Group& a, const Group& b) {
+    return b.mAfter < a.mAfter;
+  });
+
+  double count = 1.0;
+  int used = 0;
+  size_t paletteGroup = 0;
+  for (; paletteGroup < groups.size(); ++paletteGroup) {
+    const Group& group = groups[paletteGroup];
+    if (group.mAfter == Sim::nNoCell) {
+      break;
+    }
+    int after = (int)(cells.end() -
+      std::upper_bound(cells.begin(), cells.end(), group.mAfter));
+    count *= Choose(after - used, group.mCount);
+    used += group.mCount;
+  }
+  // ways[k] counts the choices of the palette groups so far that placed k.
+  int left = (int)cells.size() - used;
+  std::vector<double> ways(1, 1.0);
+  for (size_t i = paletteGroup; i < groups.size(); ++i) {
+    std::vector<double> nextWays(ways.size() + groups[i].mCount, 0.0);
+    for (int k = 0; k < (int)ways.size(); ++k) {
+      for (int placed = 0; placed <= groups[i].mCount; ++placed) {
+        nextWays[k + placed] += ways[k] * Choose(left - k, placed);
+      }
+    }
+    ways = std::move(nextWays);
+  }
+  double paletteCount = 0.0;
+  for (double way: ways) {
+    paletteCount += way;
+  }
+  count *= paletteCount;
+  if (count >= (double)UINT64_MAX) {
+    return UINT64_MAX;
+  }
+  return (uint64_t)count;
+}
+
+void AddSkipped(const Search& search, uint64_t skipped) {
+  std::atomic<uint64_t>& total = search.mStats->mSkipped;
+  uint64_t current = total.load(std::memory_order_relaxed);
+  uint64_t next;
+  do {
+    next = current > UINT64_MAX - skipped ? UINT64_MAX : current + skipped;
+  } while (!total.compare_exchange_weak(
+    current, next, std::memory_order_relaxed));
+}
+
+std::vector<Sim::Placement> Split(
+  const Search& search, const Sim::Placement& partial) {
+  auto freeIt = std::find(partial.begin(), partial.end(), nFreeCell);
+  if (freeIt == partial.end()) {
+    return {partial};
+  }
+  Sim::Board board;
+  InitPartialBoard(board, *search.mLevel, partial);
+  std::vector<Sim::Placement> parts;
+  Sim::Placement part = partial;
+  size_t freeIdx = freeIt - partial.begin();
+  part[freeIdx] = Sim::nNoCell;
+  parts.push_back(part);
+  for (int cell = 0; cell < board.CellCount(); ++cell) {
+    if (board.Placeable(cell)) {
+      part[freeIdx] = cell;
+      parts.push_back(part);
+    }
+  }
+  return parts;
+}
+
+struct Enumerator {
+  bool Evaluate();
+  bool Recurse(size_t freeIdx);
+
+  const Search* mSearch;
+  const SolutionFn* mSolutionFn;
+  Sim::Board mBoard;
+  // Levels whose digits come and go run on the step engine.
+  bool mUseEvents;
+  Sim::EventSimulation mSimulation;
+  Sim::Simulation mStepSimulation;
+  Reach::Analysis mAnalysis;
+  Sim::Placement mPlacement;
+  std::vector<int> mPlaceableModifiers;
+  std::vector<int> mFree;
+};
+
+bool Enumerator::Evaluate() {
+  if (mSearch->mCancel->load(std::memory_order_relaxed)) {
+    return false;
+  }
+  mSearch->mStats->mPlacements.fetch_add(1, std::memory_order_relaxed);
+  uint64_t key = HashPlacement(mSearch->mLevelHash, mPlacement);
+  Sim::RunResult result;
+  if (!mSearch->mCache->Find(key, &result)) {
+    mSearch->mStats->mSimulations.fetch_add(1, std::memory_order_relaxed);
+    result = mUseEvents
+      ? Sim::Run(mSimulation, mBoard, mSearch->mMaxTicks)
+      : Sim::Run(mStepSimulation, mBoard, mSearch->mMaxTicks);
+    // Only the step engine can tell that digits are going round in a loop.
+    if (mUseEvents && !result.mDecided) {
+      result = Sim::Run(mStepSimulation, mBoard, mSearch->mMaxTicks);
+    }
+    mSearch->mCache->Insert(key, result);
+  }
+  if (!result.mDecided) {
+    mSearch->mStats->mUndecided.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (result.mSolved) {
+    return (*mSolutionFn)(mPlacement, result);
+  }
+  return true;
+}
+
+bool Enumerator::Recurse(size_t freeIdx) {
+  if (freeIdx == mFree.size()) {
+    return Evaluate();
+  }
+  if (mSearch->mPrune && !mAnalysis.Run(*mSearch->mLevel, mPlacement)) {
+    mSearch->mStats->mPruned.fetch_add(1, std::memory_order_relaxed);
+    AddSkipped(*mSearch, CompletionCount(*mSearch, mBoard, mPlacement));
+    return true;
+  }
+  int placeableIdx = mFree[freeIdx];
+  int firstCell = 0;
+  int prevIdentical = mSearch->mPrevIdentical[placeableIdx];
+  if (prevIdentical == -1 || mPlacement[prevIdentical] == Sim::nNoCell) {
+    mPlacement[placeableIdx] = Sim::nNoCell;
+    if (!Recurse(freeIdx + 1)) {
+      return false;
+    }
+  }
+  else {
+    firstCell = mPlacement[prevIdentical] + 1;
+  }
+  for (int cell = firstCell; cell < mBoard.CellCount(); ++cell) {
+    if (!mBoard.Placeable(cell)) {
+      continue;
+    }
+    mPlacement[placeableIdx] = cell;
+    mBoard.SetModifier(cell, mPlaceableModifiers[placeableIdx]);
+    bool proceed = Recurse(freeIdx + 1);
+    mBoard.SetModifier(cell, Sim::nNoModifier);
+    if (!proceed) {
+      return false;
+    }
+  }
+  mPlacement[placeableIdx] = nFreeCell;
+  return true;
+}
+
+bool Enumerate(
+  const Search& search,
+  const Sim::Placement& partial,
+  const SolutionFn& solutionFn) {
+  Enumerator enumerator;
+  enumerator.mSearch = &search;
+  enumerator.mSolutionFn = &solutionFn;
+  InitPartialBoard(enumerator.mBoard, *search.mLevel, partial);
+  enumerator.mUseEvents = Sim::FixedDigits(*search.mLevel);
+  enumerator.mPlacement = partial;
+  enumerator.mPlaceableModifiers = Sim::PlaceableModifiers(*search.mLevel);
+  for (size_t i = 0; i < partial.size(); ++i) {
+    if (partial[i] == nFreeCell) {
+      enumerator.mFree.push_back((int)i);
+    }
+  }
+  return enumerator.Recurse(0);
+}
+
+bool MatchPartial(
+  const Sim::LevelDesc& levelDesc,
+  const Sim::Placement& solution,
+  const Sim::Placement& partial,
+  Sim::Placement* matched) {
+  // Every group's cells are a multiset that the fixed placeables of the group
+  // take from first. The free placeables get whatever is left.
+  std::vector<int> groups = IdenticalGroups(levelDesc);
+  std::unordered_map<int, std::vector<int>> groupCells;
+  for (size_t i = 0; i < solution.size(); ++i) {
+    groupCells[groups[i]].push_back(solution[i]);
+  }
+  *matched = partial;
+  for (size_t i = 0; i < partial.size(); ++i) {
+    if (partial[i] == nFreeCell) {
+      continue;
+    }
+    std::vector<int>& cells = groupCells[groups[i]];
+    auto it = std::find(cells.begin(), cells.end(), partial[i]);
+    if (it == cells.end()) {
+      return false;
+    }
+    cells.erase(it);
+  }
+  for (size_t i = 0; i < partial.size(); ++i) {
+    if (partial[i] != nFreeCell) {
+      continue;
+    }
+    std::vector<int>& cells = groupCells[groups[i]];
+    (*matched)[i] = cells.front();
+    cells.erase(cells.begin());
+  }
+  return true;
+}
+
+bool Score::operator<(const Score& other) const {
+  if (mMet != other.mMet) {
+    return mMet < other.mMet;
+  }
+  return mDistance > other.mDistance;
+}
+
+// Values wrap around, so 9 is one step away from 0.
+int ValueDistance(int valueA, int valueB) {
+  int difference = std::abs(valueA - valueB);
+  return std::min(difference, 10 - difference);
+}
+
+Score ScoreBoard(
+  Sim::Simulation& simulation,
+  const Sim::Board& board,
+  int maxTicks,
+  Sim::RunResult* result) {
+  const Sim::LevelDesc& level = *board.mLevel;
+  int requirementCount = (int)level.mRequirements.size();
+  std::vector<int> closest(requirementCount, INT_MAX);
+  Score score = {0, 0};
+  *result = {false, 0, false};
+  simulation.Reset(board);
+  Sim::Simulation snapshot = {};
+  bool settled = false;
+  while (simulation.mTick < maxTicks) {
+    simulation.Step();
+    int met = 0;
+    for (int i = 0; i < requirementCount; ++i) {
+      const Requirement& requirement = level.mRequirements[i];
+      int digitIdx = simulation.mDigitLayer[board.CellIndex(requirement.mCell)];
+      if (
+        digitIdx != Sim::nNoDigit &&
+        simulation.mDigits[digitIdx].mValue == requirement.mValue) {
+        ++met;
+      }
+      for (size_t j = 0; j < simulation.mDigits.size(); ++j) {
+        if (!simulation.mLive[j]) {
+          continue;
+        }
+        const Digit& digit = simulation.mDigits[j];
+        int distance = std::abs(digit.mCell[0] - requirement.mCell[0]) +
+          std::abs(digit.mCell[1] - requirement.mCell[1]) +
+          ValueDistance(digit.mValue, requirement.mValue);
+        closest[i] = std::min(closest[i], distance);
+      }
+    }
+    score.mMet = std::max(score.mMet, met);
+    if (met == requirementCount) {
+      *result = {true, simulation.mTick, true};
+      break;
+    }
+    bool prevSettled = settled;
+    settled = simulation.Settled();
+    // Once the whole state repeats, the rest of the run can't score any
+    // better. The state is saved at every power of two tick.
+    if ((settled && prevSettled) || simulation.Repeats(snapshot)) {
+      result->mDecided = true;
+      break;
+    }
+    if ((simulation.mTick & (simulation.mTick - 1)) == 0) {
+      simulation.SaveState(&snapshot);
+    }
+  }
+  if (!result->mSolved) {
+    result->mTick = simulation.mTick;
+  }
+  for (int distance: closest) {
+    if (distance != INT_MAX) {
+      score.mDistance += distance;
+    }
+  }
+  return score;
+}
+
+// A partial placement from the beam with one more placeable decided.
+struct BeamCandidate {
+  int mNodeIdx;
+  int mCell;
+  bool mScored;
+  Score mScore;
+  Sim::RunResult mRun;
+};
+
+// Pruning keeps going while at least one in this many analyzed nodes is
+// ruled out. Otherwise the analyses only get this fraction of the time.
+constexpr int nPrunedRatio = 16;
+constexpr int nAnalysisShare = 5;
+
+struct Beam {
+  bool Stopped();
+  bool Pruning() const;
+  // Returns false when the search has to stop.
+  bool Pass(int width);
+  void ScoreCandidates();
+  void ScoreWorker();
+  Sim::Placement CandidatePlacement(const BeamCandidate& candidate) const;
+  void Consider(const BeamCandidate& candidate);
+  void Consider(
+    const Sim::Placement& placement,
+    const Score& score,
+    const Sim::RunResult& run);
+  void PlaceNode(Sim::Board& board, const Sim::Placement& node, bool place);
+
+  const Search* mSearch;
+  const BeamOptions* mOptions;
+  const ImprovementFn* mImprovementFn;
+  std::chrono::steady_clock::time_point mDeadline;
+  std::vector<int> mPlaceableModifiers;
+  std::vector<int> mFree;
+  Sim::Placement mRoot;
+  // The partial placements kept after deciding mFree[0] to mFree[mDepth - 1].
+  std::vector<Sim::Placement> mNodes;
+  std::vector<BeamCandidate> mCandidates;
+  std::atomic<size_t> mNextCandidate;
+  std::atomic<bool> mStop;
+  size_t mDepth;
+  int mWidth;
+  // Whether the current pass had to drop any candidate.
+  bool mTruncated;
+  // Whether the reachability pre-pass allows a solution of the partial
+  // placement the search started from. Only then are nodes pruned.
+  bool mSolvable;
+  Reach::Analysis mAnalysis;
+  std::chrono::steady_clock::time_point mStart;
+  std::chrono::steady_clock::duration mAnalysisTime;
+  int mAnalyzed;
+  int mPruned;
+  bool mHasBest;
+  BeamResult mBest;
+};
+
+bool Beam::Stopped() {
+  if (mStop.load(std::memory_order_relaxed)) {
+    return true;
+  }
+  if (
+    mSearch->mCancel->load(std::memory_order_relaxed) ||
+    std::chrono::steady_clock::now() >= mDeadline) {
+    mStop.store(true, std::memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+void Beam::PlaceNode(
+  Sim::Board& board, const Sim::Placement& node, bool place) {
+  for (size_t i = 0; i < node.size(); ++i) {
+    if (node[i] >= 0) {
+      board.SetModifier(
+        node[i], place ? mPlaceableModifiers[i] : Sim::nNoModifier);
+    }
+  }
+}
+
+bool Beam::Pruning() const {
+  if (!mSearch->mPrune || !mSolvable || mDepth + 1 == mFree.size()) {
+    return false;
+  }
+  // Open fields give digits so many paths that little gets ruled out.
+  if (mPruned * nPrunedRatio >= mAnalyzed) {
+    return true;
+  }
+  std::chrono::steady_clock::duration elapsed =
+    std::chrono::steady_clock::now() - mStart;
+  return mAnalysisTime * nAnalysisShare < elapsed;
+}
+
+bool Beam::Pass(int width) {
+  mWidth = width;
+  mTruncated = false;
+  mNodes.assign(1, mRoot);
+  Sim::Board board;
+  board.Init(*mSearch->mLevel);
+  for (mDepth = 0; mDepth < mFree.size(); ++mDepth) {
+    int placeableIdx = mFree[mDepth];
+    int prevIdentical = mSearch->mPrevIdentical[placeableIdx];
+    mCandidates.clear();
+    for (int nodeIdx = 0; nodeIdx < (int)mNodes.size(); ++nodeIdx) {
+      const Sim::Placement& node = mNodes[nodeIdx];
+      int firstCell = 0;
+      if (prevIdentical == -1 || node[prevIdentical] == Sim::nNoCell) {
+        mCandidates.push_back({nodeIdx, Sim::nNoCell, false, {}, {}});
+      }
+      else {
+        firstCell = node[prevIdentical] + 1;
+      }
+      PlaceNode(board, node, true);
+      for (int cell = firstCell; cell < board.CellCount(); ++cell) {
+        if (board.Placeable(cell)) {
+          mCandidates.push_back({nodeIdx, cell, false, {}, {}});
+        }
+      }
+      PlaceNode(board, node, false);
+    }
+
+    ScoreCandidates();
+    for (const BeamCandidate& candidate: mCandidates) {
+      if (candidate.mScored) {
+        Consider(candidate);
+      }
+    }
+    if (Stopped()) {
+      return false;
+    }
+
+    std::stable_sort(
+      mCandidates.begin(),
+      mCandidates.end(),
+      [](const BeamCandidate& a, const BeamCandidate& b) {
+        return b.mScore < a.mScore;
+      });
+    std::vector<Sim::Placement> nodes;
+    nodes.reserve(std::min<size_t>(mCandidates.size(), width));
+    for (size_t i = 0; i < mCandidates.size(); ++i) {
+      if ((int)nodes.size() == width) {
+        mTruncated = true;
+        break;
+      }
+      const BeamCandidate& candidate = mCandidates[i];
+      Sim::Placement node = mNodes[candidate.mNodeIdx];
+      node[placeableIdx] = candidate.mCell;
+      // The pre-pass costs about as much as hundreds of runs on large fields,
+      // so only the candidates that would be kept go through it. Those that
+      // can't lead to a solution make room for the next best.
+      if (Pruning()) {
+        if (Stopped()) {
+          return false;
+        }
+        std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+        bool solvable = mAnalysis.Run(*mSearch->mLevel, node);
+        mAnalysisTime += std::chrono::steady_clock::now() - start;
+        ++mAnalyzed;
+        if (!solvable) {
+          ++mPruned;
+          mSearch->mStats->mPruned.fetch_add(1, std::memory_order_relaxed);
+          PlaceNode(board, node, true);
+          AddSkipped(*mSearch, CompletionCount(*mSearch, board, node));
+          PlaceNode(board, node, false);
+          continue;
+        }
+      }
+      nodes.push_back(std::move(node));
+    }
+    // Every candidate was ruled out, so no wider pass will find a solution.
+    mNodes = std::move(nodes);
+    if (mNodes.empty()) {
+      return true;
+    }
+  }
+  return true;
+}
+
+void Beam::ScoreCandidates() {
+  mNextCandidate.store(0);
+  int threadCount = std::max(1, mOptions->mThreads);
+  std::vector<std::thread> threads;
+  for (int i = 1; i < threadCount; ++i) {
+    threads.emplace_back(&Beam::ScoreWorker, this);
+  }
+  ScoreWorker();
+  for (std::thread& thread: threads) {
+    thread.join();
+  }
+}
+
+void Beam::ScoreWorker() {
+  Sim::Board board;
+  board.Init(*mSearch->mLevel);
+  Sim::Simulation simulation;
+  int placeableIdx = mFree[mDepth];
+  size_t candidateIdx;
+  while ((candidateIdx = mNextCandidate.fetch_add(1)) < mCandidates.size()) {
+    if (Stopped()) {
+      return;
+    }
+    BeamCandidate& candidate = mCandidates[candidateIdx];
+    const Sim::Placement& node = mNodes[candidate.mNodeIdx];
+    PlaceNode(board, node, true);
+    if (candidate.mCell >= 0) {
+      board.SetModifier(candidate.mCell, mPlaceableModifiers[placeableIdx]);
+    }
+    candidate.mScore =
+      ScoreBoard(simulation, board, mSearch->mMaxTicks, &candidate.mRun);
+    candidate.mScored = true;
+    if (candidate.mCell >= 0) {
+      board.SetModifier(candidate.mCell, Sim::nNoModifier);
+    }
+    PlaceNode(board, node, false);
+    mSearch->mStats->mPlacements.fetch_add(1, std::memory_order_relaxed);
+    mSearch->mStats->mSimulations.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+Sim::Placement Beam::CandidatePlacement(const BeamCandidate& candidate) const {
+  Sim::Placement placement = mNodes[candidate.mNodeIdx];
+  placement[mFree[mDepth]] = candidate.mCell;
+  for (int& cell: placement) {
+    if (cell == nFreeCell) {
+      cell = Sim::nNoCell;
+    }
+  }
+  return placement;
+}
+
+void Beam::Consider(const BeamCandidate& candidate) {
+  if (!mHasBest || mBest.mScore < candidate.mScore) {
+    Consider(CandidatePlacement(candidate), candidate.mScore, candidate.mRun);
+  }
+}
+
+void Beam::Consider(
+  const Sim::Placement& placement,
+  const Score& score,
+  const Sim::RunResult& run) {
+  if (mHasBest && !(mBest.mScore < score)) {
+    return;
+  }
+  mHasBest = true;
+  mBest = {placement, score, run, mWidth};
+  if (!(*mImprovementFn)(mBest) || run.mSolved) {
+    mStop.store(true);
+  }
+}
+
+BeamResult BeamSearch(
+  const Search& search,
+  const Sim::Placement& partial,
+  const BeamOptions& options,
+  const ImprovementFn& improvementFn) {
+  Beam beam;
+  beam.mSearch = &search;
+  beam.mOptions = &options;
+  beam.mImprovementFn = &improvementFn;
+  beam.mDeadline = std::chrono::steady_clock::now() + options.mTime;
+  beam.mPlaceableModifiers = Sim::PlaceableModifiers(*search.mLevel);
+  beam.mRoot = partial;
+  for (size_t i = 0; i < partial.size(); ++i) {
+    if (partial[i] == nFreeCell) {
+      beam.mFree.push_back((int)i);
+    }
+  }
+  beam.mStop.store(false);
+  beam.mWidth = 0;
+  beam.mHasBest = false;
+  beam.mStart = std::chrono::steady_clock::now();
+  beam.mSolvable = beam.mAnalysis.Run(*search.mLevel, partial);
+  beam.mAnalysisTime = std::chrono::steady_clock::now() - beam.mStart;
+  beam.mAnalyzed = 0;
+  beam.mPruned = 0;
+
+  // Leaving every free placeable in the palette is the first answer.
+  Sim::Board board;
+  InitPartialBoard(board, *search.mLevel, partial);
+  Sim::Simulation simulation;
+  Sim::RunResult run;
+  Score score = ScoreBoard(simulation, board, search.mMaxTicks, &run);
+  Sim::Placement placement = partial;
+  std::replace(placement.begin(), placement.end(), nFreeCell, Sim::nNoCell);
+  beam.Consider(placement, score, run);
+
+  // Every node of a pass can expand into a candidate for each cell.
+  size_t candidateBytes = (board.CellCount() + 1) * sizeof(BeamCandidate) +
+    sizeof(Sim::Placement) + partial.size() * sizeof(int);
+  int maxWidth = (int)std::clamp<size_t>(
+    options.mMemory / candidateBytes, 1, INT_MAX / 2);
+  for (int width = 1; !beam.mFree.empty() && !beam.Stopped(); width *= 2) {
+    width = std::min(width, maxWidth);
+    if (!beam.Pass(width) || !beam.mTruncated || width == maxWidth) {
+      break;
+    }
+  }
+  return beam.mBest;
+}
+
+} // namespace Solver
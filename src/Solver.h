@@ -0,0 +1,166 @@
+#ifndef Solver_h
+#define Solver_h
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Simulation.h"
+
+// Finds placements that solve a level by enumerating them and running the
+// headless simulation on each. Levels too large to enumerate get an anytime
+// beam search instead.
+namespace Solver {
+
+// Marks a placeable whose cell the solver chooses in a partial placement.
+constexpr int nFreeCell = -2;
+
+// A bounded, thread safe map from a level and complete placement hash to the
+// result of simulating that placement. A shard that fills up is cleared.
+struct TranspositionCache {
+  TranspositionCache(size_t capacity);
+  bool Find(uint64_t key, Sim::RunResult* result);
+  void Insert(uint64_t key, const Sim::RunResult& result);
+
+  static constexpr int smShardCount = 64;
+  struct Shard {
+    std::mutex mMutex;
+    std::unordered_map<uint64_t, Sim::RunResult> mResults;
+  };
+  Shard mShards[smShardCount];
+  size_t mShardCapacity;
+  std::atomic<uint64_t> mHits;
+  std::atomic<uint64_t> mMisses;
+};
+
+struct Stats {
+  std::atomic<uint64_t> mPlacements = 0;
+  std::atomic<uint64_t> mSimulations = 0;
+  // Partial placements the reachability pre-pass proved unsolvable, each
+  // cutting off every placement that completes it.
+  std::atomic<uint64_t> mPruned = 0;
+  // The complete placements under the pruned partial placements, which were
+  // never simulated. It stops at UINT64_MAX.
+  std::atomic<uint64_t> mSkipped = 0;
+  // Placements whose runs reached maxTicks without solving, settling or
+  // repeating. They are not solutions, but they aren't proven unsolvable.
+  std::atomic<uint64_t> mUndecided = 0;
+};
+
+uint64_t HashLevelDesc(const Sim::LevelDesc& levelDesc, int maxTicks);
+uint64_t HashPlacement(uint64_t levelHash, const Sim::Placement& placement);
+
+// Placeables with the same modifier are interchangeable. Each placeable gets
+// the index of the first placeable identical to it.
+std::vector<int> IdenticalGroups(const Sim::LevelDesc& levelDesc);
+
+// Everything a search needs that stays the same across the tasks it is split
+// into.
+struct Search {
+  void Init(
+    const Sim::LevelDesc& levelDesc,
+    const Sim::Placement& partial,
+    int maxTicks,
+    TranspositionCache* cache,
+    Stats* stats,
+    const std::atomic<bool>* cancel);
+
+  const Sim::LevelDesc* mLevel;
+  int mMaxTicks;
+  uint64_t mLevelHash;
+  // Whether partial placements go through Reach::Analysis before their
+  // completions are searched. Init turns it on.
+  bool mPrune;
+  // Identical free placeables only ever take cells in increasing order, so a
+  // board is only visited once. This holds the previous free placeable that
+  // is identical to each placeable or -1.
+  std::vector<int> mPrevIdentical;
+  TranspositionCache* mCache;
+  Stats* mStats;
+  const std::atomic<bool>* mCancel;
+};
+
+// Called with every solving placement. Returning false stops the search.
+typedef std::function<bool(const Sim::Placement&, const Sim::RunResult&)>
+  SolutionFn;
+
+// Splits a partial placement into one partial placement for every choice of
+// its first free placeable. The parts can be enumerated independently.
+std::vector<Sim::Placement> Split(
+  const Search& search, const Sim::Placement& partial);
+// Visits every completion of a partial placement. Returns false when the
+// search was cancelled or solutionFn stopped it.
+bool Enumerate(
+  const Search& search,
+  const Sim::Placement& partial,
+  const SolutionFn& solutionFn);
+
+// Turns a solution of the level with every placeable free into a solution
+// that agrees with the fixed cells of partial, swapping identical placeables
+// where needed. Returns false when the solution can't agree with partial.
+bool MatchPartial(
+  const Sim::LevelDesc& levelDesc,
+  const Sim::Placement& solution,
+  const Sim::Placement& partial,
+  Sim::Placement* matched);
+
+// How close a placement comes to solving its level. Better scores compare
+// greater.
+struct Score {
+  bool operator<(const Score& other) const;
+
+  // The most requirements met on a single tick.
+  int mMet;
+  // Summed over requirements, the least any digit was ever away from one. A
+  // digit is away by the cells between it and the requirement plus the steps
+  // between its value and the required value.
+  int mDistance;
+};
+// Runs a board for up to maxTicks, stopping early when it is solved, settled
+// like Sim::Run does, or caught in a loop.
+Score ScoreBoard(
+  Sim::Simulation& simulation,
+  const Sim::Board& board,
+  int maxTicks,
+  Sim::RunResult* result);
+
+struct BeamOptions {
+  std::chrono::steady_clock::duration mTime;
+  // A bound on the bytes taken by the beam and the candidates it expands into.
+  // It limits how wide the beam can get.
+  size_t mMemory;
+  int mThreads;
+};
+
+struct BeamResult {
+  // Placeables the search never placed hold Sim::nNoCell.
+  Sim::Placement mPlacement;
+  Score mScore;
+  Sim::RunResult mRun;
+  // The width of the pass that found the placement.
+  int mWidth;
+};
+
+// Called whenever the best placement improves. Returning false stops the
+// search.
+typedef std::function<bool(const BeamResult&)> ImprovementFn;
+
+// Decides the free placeables of a partial placement one at a time, keeping
+// only the best scoring partial placements after each decision. Placeables
+// that are still undecided stay in the palette while scoring. Passes are
+// repeated with a doubling beam width until the time or memory budget runs
+// out, a pass was exhaustive, or a solution was found, so the result improves
+// as the budget grows. Returns the best placement seen in any pass.
+BeamResult BeamSearch(
+  const Search& search,
+  const Sim::Placement& partial,
+  const BeamOptions& options,
+  const ImprovementFn& improvementFn);
+
+} // namespace Solver
+
+#endif
@@ -0,0 +1,355 @@
+// Runs the anytime beam search on a level and prints every improvement it
+// finds. Levels come from the built in levels, a request file in the daemon's
+// format, or a generator that makes large random levels that are solvable by
+// construction.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "Solver.h"
+#include "SolverProtocol.h"
+
+// Digits are placed first, then locked modifiers on about one cell in
+// nLockedModifierSpacing, then the placeables on a hidden placement. The
+// requirements go wherever the digits are at some tick of the hidden
+// placement's run.
+constexpr int nLockedModifierSpacing = 25;
+
+int RandomInt(std::mt19937& random, int min, int max) {
+  return std::uniform_int_distribution<int>(min, max)(random);
+}
+
+Filter RandomFilter(std::mt19937& random) {
+  Filter filter = {{-1, -1}, 0, (Filter::Type)RandomInt(random, 0, 3), true};
+  int minValue = filter.mType == Filter::Type::Mod ? 2 : 1;
+  filter.mValue = RandomInt(random, minValue, 9);
+  return filter;
+}
+
+Shifter RandomShifter(std::mt19937& random) {
+  return {{-1, -1}, (Direction)RandomInt(random, 0, 3), true};
+}
+
+// Returns a free cell, one that holds no digit or modifier yet.
+int RandomFreeCell(std::mt19937& random, const Sim::Board& board) {
+  int cell;
+  do {
+    cell = RandomInt(random, 0, board.CellCount() - 1);
+  } while (!board.Placeable(cell));
+  return cell;
+}
+
+// Runs a board until the tick or until it settles, calling cellFn with the
+// cell of every digit after every step.
+template<typename CellFn>
+void RunGenerated(
+  Sim::Simulation& simulation,
+  const Sim::Board& board,
+  int ticks,
+  CellFn cellFn) {
+  simulation.Reset(board);
+  bool settled = false;
+  while (simulation.mTick < ticks) {
+    simulation.Step();
+    for (const Digit& digit: simulation.mDigits) {
+      cellFn(board.CellIndex(digit.mCell));
+    }
+    bool prevSettled = settled;
+    settled = simulation.Settled();
+    if (settled && prevSettled) {
+      break;
+    }
+  }
+}
+
+bool TryGenerateLevel(
+  Sim::LevelDesc* level,
+  int digitCount,
+  int placeableCount,
+  std::mt19937& random) {
+  Sim::Board board;
+  int cellCount = level->mWidth * level->mHeight;
+  int lockedCount = cellCount / nLockedModifierSpacing;
+  if (digitCount + lockedCount + placeableCount > cellCount) {
+    return false;
+  }
+  level->mDigits.clear();
+  level->mRequirements.clear();
+  level->mFilters.clear();
+  level->mShifters.clear();
+  for (int i = 0; i < digitCount; ++i) {
+    board.Init(*level);
+    int cell = RandomFreeCell(random, board);
+    level->mDigits.push_back(
+      {{cell % level->mWidth, cell / level->mWidth},
+       RandomInt(random, 0, 9),
+       (Direction)RandomInt(random, 0, 3)});
+  }
+  for (int i = 0; i < lockedCount; ++i) {
+    board.Init(*level);
+    int cell = RandomFreeCell(random, board);
+    int startCell[2] = {cell % level->mWidth, cell / level->mWidth};
+    if (RandomInt(random, 0, 1) == 0) {
+      Filter filter = RandomFilter(random);
+      filter.mPlaceable = false;
+      std::copy(startCell, startCell + 2, filter.mStartCell);
+      level->mFilters.push_back(filter);
+    }
+    else {
+      Shifter shifter = RandomShifter(random);
+      shifter.mPlaceable = false;
+      std::copy(startCell, startCell + 2, shifter.mStartCell);
+      level->mShifters.push_back(shifter);
+    }
+  }
+  for (int i = 0; i < placeableCount; ++i) {
+    if (RandomInt(random, 0, 1) == 0) {
+      level->mFilters.push_back(RandomFilter(random));
+    }
+    else {
+      level->mShifters.push_back(RandomShifter(random));
+    }
+  }
+
+  // Every placeable goes on a cell some digit crosses with the placeables
+  // before it in place, so all of them matter to the hidden run.
+  board.Init(*level);
+  Sim::Simulation simulation;
+  int ticks = RandomInt(
+    random, level->mWidth + level->mHeight, Sim::DefaultMaxTicks(*level) / 2);
+  std::vector<int> placeableModifiers = Sim::PlaceableModifiers(*level);
+  for (int modifier: placeableModifiers) {
+    std::vector<int> crossed;
+    RunGenerated(simulation, board, ticks, [&](int cell) {
+      if (board.Placeable(cell)) {
+        crossed.push_back(cell);
+      }
+    });
+    if (crossed.empty()) {
+      return false;
+    }
+    int cell = crossed[RandomInt(random, 0, (int)crossed.size() - 1)];
+    board.SetModifier(cell, modifier);
+  }
+  RunGenerated(simulation, board, ticks, [](int) {});
+  for (int cell = 0; cell < cellCount; ++cell) {
+    int digitIdx = simulation.mDigitLayer[cell];
+    if (
+      digitIdx != Sim::nNoDigit && board.mModifiers[cell] == Sim::nNoModifier) {
+      level->mRequirements.push_back(
+        {{cell % level->mWidth, cell / level->mWidth},
+         simulation.mDigits[digitIdx].mValue});
+    }
+  }
+  std::string error;
+  if (!Sim::ValidLevelDesc(*level, &error)) {
+    return false;
+  }
+  // Levels that solve themselves aren't worth searching.
+  Sim::Board emptyBoard;
+  emptyBoard.Init(*level);
+  return !Sim::Run(simulation, emptyBoard, Sim::DefaultMaxTicks(*level))
+            .mSolved;
+}
+
+void PrintPlacement(
+  const char* label,
+  const Sim::LevelDesc& level,
+  const Sim::Placement& placement,
+  int tick) {
+  std::printf("%s %d", label, tick);
+  for (int cell: placement) {
+    if (cell < 0) {
+      std::printf(" -1 -1");
+    }
+    else {
+      std::printf(" %d %d", cell % level.mWidth, cell / level.mWidth);
+    }
+  }
+  std::printf("\n");
+}
+
+int main(int argc, char* argv[]) {
+  Protocol::Request request;
+  bool hasRequest = false;
+  int generateSize[2] = {0, 0};
+  int digitCount = 6;
+  int placeableCount = 8;
+  unsigned seed = 1;
+  const char* writePath = nullptr;
+  int timeMs = 5000;
+  int memoryMb = 256;
+  int threadCount = std::max(1u, std::thread::hardware_concurrency());
+  bool prune = true;
+  for (int i = 1; i < argc; ++i) {
+    bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--level") == 0 && hasValue) {
+      int levelIdx = std::atoi(argv[++i]) - 1;
+      if (levelIdx < 0 || levelIdx >= (int)std::size(nLevels)) {
+        std::fprintf(stderr, "Level %d does not exist.\n", levelIdx + 1);
+        return 1;
+      }
+      request.mLevel = Sim::MakeLevelDesc(nLevels[levelIdx]);
+      request.mPartial.assign(
+        Sim::PlaceableCount(request.mLevel), Solver::nFreeCell);
+      request.mMaxTicks = Sim::DefaultMaxTicks(request.mLevel);
+      hasRequest = true;
+    }
+    else if (std::strcmp(argv[i], "--file") == 0 && hasValue) {
+      std::ifstream file(argv[++i]);
+      if (!file) {
+        std::fprintf(stderr, "Unable to open %s.\n", argv[i]);
+        return 1;
+      }
+      Protocol::RequestParser parser;
+      std::string line;
+      Protocol::ParseStatus status = Protocol::ParseStatus::More;
+      while (status == Protocol::ParseStatus::More) {
+        if (!std::getline(file, line)) {
+          break;
+        }
+        status = parser.Feed(line);
+      }
+      if (status != Protocol::ParseStatus::Done) {
+        std::fprintf(stderr, "Invalid request: %s\n", parser.mError.c_str());
+        return 1;
+      }
+      request = parser.mRequest;
+      hasRequest = true;
+    }
+    else if (std::strcmp(argv[i], "--generate") == 0 && hasValue) {
+      if (
+        std::sscanf(argv[++i], "%dx%d", &generateSize[0], &generateSize[1]) !=
+          2 ||
+        generateSize[0] <= 0 || generateSize[1] <= 0) {
+        std::fprintf(stderr, "Sizes look like 40x30.\n");
+        return 1;
+      }
+    }
+    else if (std::strcmp(argv[i], "--digits") == 0 && hasValue) {
+      digitCount = std::max(1, std::atoi(argv[++i]));
+    }
+    else if (std::strcmp(argv[i], "--placeables") == 0 && hasValue) {
+      placeableCount = std::max(0, std::atoi(argv[++i]));
+    }
+    else if (std::strcmp(argv[i], "--seed") == 0 && hasValue) {
+      seed = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "--write") == 0 && hasValue) {
+      writePath = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--time") == 0 && hasValue) {
+      timeMs = std::max(1, std::atoi(argv[++i]));
+    }
+    else if (std::strcmp(argv[i], "--memory") == 0 && hasValue) {
+      memoryMb = std::max(1, std::atoi(argv[++i]));
+    }
+    else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+      threadCount = std::max(1, std::atoi(argv[++i]));
+    }
+    else if (std::strcmp(argv[i], "--no-prune") == 0) {
+      prune = false;
+    }
+    else {
+      std::fprintf(
+        stderr,
+        "usage: %s [--level n] [--file path]\n"
+        "  [--generate WxH] [--digits n] [--placeables n] [--seed s]\n"
+        "  [--write path] [--time ms] [--memory mb] [--threads count]\n"
+        "  [--no-prune]\n",
+        argv[0]);
+      return 1;
+    }
+  }
+
+  if (generateSize[0] > 0) {
+    request.mLevel.mWidth = generateSize[0];
+    request.mLevel.mHeight = generateSize[1];
+    std::mt19937 random(seed);
+    bool generated = false;
+    for (int attempt = 0; attempt < 100 && !generated; ++attempt) {
+      generated =
+        TryGenerateLevel(&request.mLevel, digitCount, placeableCount, random);
+    }
+    if (!generated) {
+      std::fprintf(stderr, "Unable to generate a level of that size.\n");
+      return 1;
+    }
+    request.mPartial.assign(
+      Sim::PlaceableCount(request.mLevel), Solver::nFreeCell);
+    request.mMaxSolutions = 1;
+    request.mMaxTicks = Sim::DefaultMaxTicks(request.mLevel);
+    hasRequest = true;
+  }
+  if (!hasRequest) {
+    std::fprintf(stderr, "Nothing to solve. Try --level 1.\n");
+    return 1;
+  }
+  if (writePath != nullptr) {
+    std::ofstream file(writePath);
+    file << Protocol::WriteRequest(request);
+  }
+
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+  Solver::TranspositionCache cache(1);
+  Solver::Stats stats;
+  std::atomic<bool> cancel = false;
+  Solver::Search search;
+  search.Init(
+    request.mLevel,
+    request.mPartial,
+    request.mMaxTicks,
+    &cache,
+    &stats,
+    &cancel);
+  search.mPrune = prune;
+  Solver::BeamOptions options;
+  options.mTime = std::chrono::milliseconds(timeMs);
+  options.mMemory = (size_t)memoryMb << 20;
+  options.mThreads = threadCount;
+  int requirementCount = (int)request.mLevel.mRequirements.size();
+  Solver::BeamResult result = Solver::BeamSearch(
+    search,
+    request.mPartial,
+    options,
+    [&](const Solver::BeamResult& improvement) {
+      auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+        Clock::now() - start);
+      std::printf(
+        "best %d/%d distance %d width %d (%lldms)\n",
+        improvement.mScore.mMet,
+        requirementCount,
+        improvement.mScore.mDistance,
+        improvement.mWidth,
+        (long long)milliseconds.count());
+      std::fflush(stdout);
+      return true;
+    });
+  // The best placement's run can stop at maxTicks before it is decided.
+  const char* outcome = "undecided";
+  if (result.mRun.mSolved) {
+    outcome = "solution";
+  }
+  else if (result.mRun.mDecided) {
+    outcome = "unsolved";
+  }
+  PrintPlacement(
+    outcome,
+    request.mLevel,
+    result.mPlacement,
+    result.mRun.mTick);
+  std::printf(
+    "%llu placements scored, %llu pruned skipping %llu\n",
+    (unsigned long long)stats.mPlacements.load(),
+    (unsigned long long)stats.mPruned.load(),
+    (unsigned long long)stats.mSkipped.load());
+}
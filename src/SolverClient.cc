@@ -0,0 +1,179 @@
+// A small client for the solver daemon. It sends built in levels or a request
+// file and prints whatever the daemon streams back. Every request gets its own
+// connection and thread, so --all and --repeat exercise concurrent requests.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "Solver.h"
+#include "SolverProtocol.h"
+#include "SolverSocket.h"
+
+std::mutex nOutputMutex;
+
+void Print(const std::string& label, const std::string& line) {
+  std::lock_guard<std::mutex> lock(nOutputMutex);
+  std::printf("[%s] %s\n", label.c_str(), line.c_str());
+}
+
+// Returns false when the request couldn't be sent in full.
+bool RunRequest(
+  const char* socketPath, const std::string& label, const std::string& text) {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (sockaddr*)&address, sizeof(address)) < 0) {
+    Print(label, "error Unable to connect to the daemon.");
+    if (fd >= 0) {
+      close(fd);
+    }
+    return false;
+  }
+  // The daemon answers each request of a file while the rest is still being
+  // sent, so the answers are read while sending to keep both sides moving.
+  bool sent = false;
+  std::thread sender([&]() {
+    sent = WriteAll(fd, text);
+    shutdown(fd, SHUT_WR);
+  });
+
+  std::string buffer;
+  char chunk[4096];
+  ssize_t result;
+  while ((result = recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+    buffer.append(chunk, result);
+    size_t newline;
+    while ((newline = buffer.find('\n')) != std::string::npos) {
+      std::string line = buffer.substr(0, newline);
+      buffer.erase(0, newline + 1);
+      if (line.rfind("done", 0) == 0) {
+        auto milliseconds =
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+            Clock::now() - start);
+        line += " (" + std::to_string(milliseconds.count()) + "ms)";
+      }
+      Print(label, line);
+    }
+  }
+  sender.join();
+  close(fd);
+  if (!sent) {
+    Print(label, "error Unable to send the whole request.");
+  }
+  return sent;
+}
+
+std::string LevelRequest(int levelIdx, int maxSolutions, int maxTicks) {
+  Protocol::Request request;
+  request.mLevel = Sim::MakeLevelDesc(nLevels[levelIdx]);
+  request.mPartial.assign(
+    Sim::PlaceableCount(request.mLevel), Solver::nFreeCell);
+  request.mMaxSolutions = maxSolutions;
+  request.mMaxTicks = maxTicks;
+  return Protocol::WriteRequest(request);
+}
+
+int main(int argc, char* argv[]) {
+  const char* socketPath = "/tmp/filtern-solver.sock";
+  std::vector<std::pair<std::string, std::string>> requests;
+  std::vector<int> levelIdxs;
+  int maxSolutions = 1;
+  int maxTicks = 0;
+  int repeat = 1;
+  const char* filePath = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--socket") == 0 && hasValue) {
+      socketPath = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--level") == 0 && hasValue) {
+      levelIdxs.push_back(std::atoi(argv[++i]) - 1);
+    }
+    else if (std::strcmp(argv[i], "--all") == 0) {
+      for (int levelIdx = 0; levelIdx < (int)std::size(nLevels); ++levelIdx) {
+        levelIdxs.push_back(levelIdx);
+      }
+    }
+    else if (std::strcmp(argv[i], "--file") == 0 && hasValue) {
+      filePath = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--max") == 0 && hasValue) {
+      maxSolutions = std::atoi(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "--ticks") == 0 && hasValue) {
+      maxTicks = std::atoi(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "--repeat") == 0 && hasValue) {
+      repeat = std::max(1, std::atoi(argv[++i]));
+    }
+    else {
+      std::fprintf(
+        stderr,
+        "usage: %s [--socket path] [--level n]... [--all] [--file path]\n"
+        "  [--max solutions] [--ticks max] [--repeat count]\n",
+        argv[0]);
+      return 1;
+    }
+  }
+
+  for (int levelIdx: levelIdxs) {
+    if (levelIdx < 0 || levelIdx >= (int)std::size(nLevels)) {
+      std::fprintf(stderr, "Level %d does not exist.\n", levelIdx + 1);
+      return 1;
+    }
+    requests.push_back(
+      {std::string(nLevels[levelIdx].mName),
+       LevelRequest(levelIdx, maxSolutions, maxTicks)});
+  }
+  if (filePath != nullptr) {
+    std::ifstream file(filePath);
+    if (!file) {
+      std::fprintf(stderr, "Unable to open %s.\n", filePath);
+      return 1;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    requests.push_back({filePath, text.str()});
+  }
+  if (requests.empty()) {
+    std::fprintf(stderr, "Nothing to request. Try --all.\n");
+    return 1;
+  }
+
+  std::vector<std::thread> threads;
+  std::vector<char> succeeded(repeat * requests.size(), false);
+  for (int i = 0; i < repeat; ++i) {
+    for (size_t j = 0; j < requests.size(); ++j) {
+      const auto& [label, text] = requests[j];
+      std::string repeatLabel = label;
+      if (repeat > 1) {
+        repeatLabel += " #" + std::to_string(i + 1);
+      }
+      char* success = &succeeded[i * requests.size() + j];
+      threads.emplace_back([=, &text]() {
+        *success = RunRequest(socketPath, repeatLabel, text);
+      });
+    }
+  }
+  for (std::thread& thread: threads) {
+    thread.join();
+  }
+  bool allSucceeded = std::find(succeeded.begin(), succeeded.end(), false) ==
+    succeeded.end();
+  return allSucceeded ? 0 : 1;
+}
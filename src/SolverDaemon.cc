@@ -0,0 +1,661 @@
+// A long running local solver. Clients connect over a Unix domain socket and
+// send requests in the format described in SolverProtocol.h. Every search is
+// split into tasks that a shared pool of workers takes from round robin, so
+// concurrent requests make progress together. Identical requests that arrive
+// while a search is running join it, finished searches are kept in a bounded
+// solution cache, and all searches share one transposition cache. Every client
+// is served on its own thread, up to nMaxClients at a time.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <list>
+#include <memory>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#include "Solver.h"
+#include "SolverProtocol.h"
+#include "SolverSocket.h"
+
+const char* nDefaultSocketPath = "/tmp/filtern-solver.sock";
+const char* nSocketPath = nDefaultSocketPath;
+constexpr size_t nTranspositionCapacity = 1 << 22;
+constexpr size_t nSolutionCacheCapacity = 64 << 20;
+// How often a client waiting on a search is checked for having hung up.
+constexpr std::chrono::milliseconds nHangUpInterval {100};
+// Connections beyond this wait in the listen backlog until a client leaves.
+constexpr size_t nMaxClients = 64;
+bool nPrune = true;
+
+struct Solution {
+  Sim::Placement mPlacement;
+  int mTick;
+};
+
+enum class NextStatus {
+  Line,
+  Timeout,
+  Done,
+};
+
+// The lines waiting to be written back to one client for one request.
+struct Subscriber {
+  // Both return false once the subscriber has finished.
+  bool Send(const std::string& line);
+  bool Finish(const std::string& line);
+  // Blocks until a line is available or the timeout passes. Done comes after
+  // the final line.
+  NextStatus Next(std::string* line, std::chrono::milliseconds timeout);
+
+  int mMaxSolutions;
+  int mSent = 0;
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  // Never more than Protocol::nMaxSolutions solutions and the done line.
+  std::deque<std::string> mLines;
+  bool mFinished = false;
+  bool mDrained = false;
+};
+
+bool Subscriber::Send(const std::string& line) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (mFinished) {
+    return false;
+  }
+  mLines.push_back(line);
+  mCondition.notify_one();
+  return true;
+}
+
+bool Subscriber::Finish(const std::string& line) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (mFinished) {
+    return false;
+  }
+  mLines.push_back(line);
+  mFinished = true;
+  mCondition.notify_one();
+  return true;
+}
+
+NextStatus Subscriber::Next(
+  std::string* line, std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mMutex);
+  if (mDrained) {
+    return NextStatus::Done;
+  }
+  bool available = mCondition.wait_for(lock, timeout, [this]() {
+    return !mLines.empty();
+  });
+  if (!available) {
+    return NextStatus::Timeout;
+  }
+  *line = std::move(mLines.front());
+  mLines.pop_front();
+  mDrained = mFinished && mLines.empty();
+  return NextStatus::Line;
+}
+
+// One running search and everyone waiting on it.
+struct SearchJob {
+  // Records a solution and streams it to the subscribers that still want
+  // solutions. Returns false once none of them do.
+  bool AddSolution(const Sim::Placement& placement, int tick);
+  void Attach(
+    const std::shared_ptr<Subscriber>& subscriber, const char* source);
+  // Drops a subscriber whose client went away. The search is cancelled once
+  // nobody is left to read its results.
+  void Detach(const std::shared_ptr<Subscriber>& subscriber);
+  void Finish();
+
+  Protocol::Request mRequest;
+  std::string mKey;
+  Solver::Search mSearch;
+  Solver::Stats mStats;
+  std::atomic<bool> mCancel = false;
+
+  // Guarded by the daemon's mutex.
+  std::vector<Sim::Placement> mTasks;
+  size_t mNextTask = 0;
+  int mRunningTasks = 0;
+  bool mFinished = false;
+
+  // Guarded by mMutex. It stops growing at Protocol::nMaxSolutions, which
+  // ends the search.
+  std::mutex mMutex;
+  std::vector<Solution> mSolutions;
+  std::vector<std::pair<std::shared_ptr<Subscriber>, const char*>> mSubscribers;
+};
+
+// Cached answers have no stats.
+std::string DoneLine(
+  size_t solutions, const Solver::Stats* stats, const char* source) {
+  uint64_t placements = stats != nullptr ? stats->mPlacements.load() : 0;
+  uint64_t pruned = stats != nullptr ? stats->mPruned.load() : 0;
+  uint64_t skipped = stats != nullptr ? stats->mSkipped.load() : 0;
+  uint64_t undecided = stats != nullptr ? stats->mUndecided.load() : 0;
+  return "done " + std::to_string(solutions) + " " +
+    std::to_string(placements) + " " + std::to_string(pruned) + " " +
+    std::to_string(skipped) + " " + std::to_string(undecided) + " " +
+    source + "\n";
+}
+
+bool Wanting(const Subscriber& subscriber) {
+  return subscriber.mSent < subscriber.mMaxSolutions;
+}
+
+bool SearchJob::AddSolution(const Sim::Placement& placement, int tick) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  // Other workers can still find some after every subscriber has enough.
+  if ((int)mSolutions.size() == Protocol::nMaxSolutions) {
+    mCancel = true;
+    return false;
+  }
+  mSolutions.push_back({placement, tick});
+  std::string line = Protocol::WriteSolution(mRequest.mLevel, placement, tick);
+  bool anyWanting = false;
+  for (auto& [subscriber, source]: mSubscribers) {
+    if (!Wanting(*subscriber)) {
+      continue;
+    }
+    subscriber->Send(line);
+    ++subscriber->mSent;
+    if (Wanting(*subscriber)) {
+      anyWanting = true;
+      continue;
+    }
+    subscriber->Finish(DoneLine(subscriber->mSent, &mStats, source));
+  }
+  if (!anyWanting) {
+    mCancel = true;
+  }
+  return anyWanting;
+}
+
+void SearchJob::Attach(
+  const std::shared_ptr<Subscriber>& subscriber, const char* source) {
+  // The caller holds mMutex. Solutions found so far are replayed first.
+  for (const Solution& solution: mSolutions) {
+    if (!Wanting(*subscriber)) {
+      break;
+    }
+    subscriber->Send(Protocol::WriteSolution(
+      mRequest.mLevel, solution.mPlacement, solution.mTick));
+    ++subscriber->mSent;
+  }
+  if (!Wanting(*subscriber)) {
+    subscriber->Finish(DoneLine(subscriber->mSent, &mStats, source));
+    return;
+  }
+  mSubscribers.push_back({subscriber, source});
+}
+
+void SearchJob::Detach(const std::shared_ptr<Subscriber>& subscriber) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto it = std::find_if(
+    mSubscribers.begin(), mSubscribers.end(), [&](const auto& entry) {
+      return entry.first == subscriber;
+    });
+  if (it == mSubscribers.end()) {
+    return;
+  }
+  mSubscribers.erase(it);
+  // Nothing reads the final line. It only ends the client's wait.
+  subscriber->Finish("");
+  if (mSubscribers.empty()) {
+    mCancel = true;
+  }
+}
+
+void SearchJob::Finish() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  for (auto& [subscriber, source]: mSubscribers) {
+    subscriber->Finish(DoneLine(subscriber->mSent, &mStats, source));
+  }
+  mSubscribers.clear();
+}
+
+struct Daemon {
+  void Start(int workerCount);
+  // Cancels every search and joins the workers.
+  void Stop();
+  // Returns the search the subscriber waits on, or null when it was answered
+  // from the cache.
+  std::shared_ptr<SearchJob> Submit(
+    Protocol::Request&& request, const std::shared_ptr<Subscriber>& subscriber);
+  void Work();
+  bool ServeFromCache(
+    const Protocol::Request& request,
+    const std::string& key,
+    const std::shared_ptr<Subscriber>& subscriber);
+  void CacheSolutions(
+    const std::string& key, const std::vector<Solution>& solutions);
+
+  Solver::TranspositionCache mTranspositions {nTranspositionCapacity};
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  std::deque<std::shared_ptr<SearchJob>> mRunnable;
+  std::unordered_map<std::string, std::shared_ptr<SearchJob>> mInFlight;
+  // Every solution of finished searches keyed by request. Like the
+  // transposition cache, it is cleared once it holds more than
+  // nSolutionCacheCapacity bytes.
+  std::unordered_map<std::string, std::vector<Solution>> mSolutionCache;
+  size_t mSolutionCacheBytes = 0;
+  std::vector<std::thread> mWorkers;
+  bool mStopping = false;
+};
+Daemon nDaemon;
+
+void Daemon::Start(int workerCount) {
+  for (int i = 0; i < workerCount; ++i) {
+    mWorkers.emplace_back([this]() {
+      Work();
+    });
+  }
+}
+
+void Daemon::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+    for (auto& [key, job]: mInFlight) {
+      job->mCancel = true;
+    }
+    mCondition.notify_all();
+  }
+  for (std::thread& worker: mWorkers) {
+    worker.join();
+  }
+}
+
+bool Daemon::ServeFromCache(
+  const Protocol::Request& request,
+  const std::string& key,
+  const std::shared_ptr<Subscriber>& subscriber) {
+  // A request with fixed cells can also be answered by the solutions of the
+  // same level with every placeable free.
+  const Protocol::Request* cachedRequest = &request;
+  auto it = mSolutionCache.find(key);
+  Protocol::Request freeRequest;
+  if (it == mSolutionCache.end()) {
+    freeRequest.mLevel = request.mLevel;
+    freeRequest.mPartial.assign(request.mPartial.size(), Solver::nFreeCell);
+    freeRequest.mMaxTicks = request.mMaxTicks;
+    it = mSolutionCache.find(Protocol::RequestKey(freeRequest));
+    if (it == mSolutionCache.end()) {
+      return false;
+    }
+    cachedRequest = &freeRequest;
+  }
+
+  for (const Solution& solution: it->second) {
+    if (!Wanting(*subscriber)) {
+      break;
+    }
+    Sim::Placement matched = solution.mPlacement;
+    if (cachedRequest != &request) {
+      bool agrees = Solver::MatchPartial(
+        request.mLevel, solution.mPlacement, request.mPartial, &matched);
+      if (!agrees) {
+        continue;
+      }
+    }
+    subscriber->Send(
+      Protocol::WriteSolution(request.mLevel, matched, solution.mTick));
+    ++subscriber->mSent;
+  }
+  subscriber->Finish(DoneLine(subscriber->mSent, nullptr, "cached"));
+  return true;
+}
+
+// The caller holds mMutex.
+void Daemon::CacheSolutions(
+  const std::string& key, const std::vector<Solution>& solutions) {
+  size_t bytes = key.size() + sizeof(solutions);
+  for (const Solution& solution: solutions) {
+    bytes += sizeof(Solution) + solution.mPlacement.size() * sizeof(int);
+  }
+  if (bytes > nSolutionCacheCapacity) {
+    return;
+  }
+  if (mSolutionCacheBytes + bytes > nSolutionCacheCapacity) {
+    mSolutionCache.clear();
+    mSolutionCacheBytes = 0;
+  }
+  if (mSolutionCache.emplace(key, solutions).second) {
+    mSolutionCacheBytes += bytes;
+  }
+}
+
+std::shared_ptr<SearchJob> Daemon::Submit(
+  Protocol::Request&& request, const std::shared_ptr<Subscriber>& subscriber) {
+  // Every subscriber wanting a bounded number of solutions bounds the
+  // solutions a job keeps and the lines a slow client has waiting.
+  subscriber->mMaxSolutions = request.mMaxSolutions == 0
+    ? Protocol::nMaxSolutions
+    : std::min(request.mMaxSolutions, Protocol::nMaxSolutions);
+  std::string key = Protocol::RequestKey(request);
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (ServeFromCache(request, key, subscriber)) {
+    return nullptr;
+  }
+
+  auto it = mInFlight.find(key);
+  if (it != mInFlight.end()) {
+    std::shared_ptr<SearchJob> job = it->second;
+    std::lock_guard<std::mutex> jobLock(job->mMutex);
+    if (!job->mCancel) {
+      job->Attach(subscriber, "joined");
+      return job;
+    }
+  }
+
+  std::shared_ptr<SearchJob> job = std::make_shared<SearchJob>();
+  job->mRequest = std::move(request);
+  job->mKey = key;
+  job->mSearch.Init(
+    job->mRequest.mLevel,
+    job->mRequest.mPartial,
+    job->mRequest.mMaxTicks,
+    &mTranspositions,
+    &job->mStats,
+    &job->mCancel);
+  job->mSearch.mPrune = nPrune;
+  job->mTasks = Solver::Split(job->mSearch, job->mRequest.mPartial);
+  job->Attach(subscriber, "searched");
+  mInFlight[key] = job;
+  mRunnable.push_back(job);
+  mCondition.notify_all();
+  return job;
+}
+
+void Daemon::Work() {
+  while (true) {
+    std::shared_ptr<SearchJob> job;
+    Sim::Placement task;
+    bool hasTask = false;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCondition.wait(lock, [this]() {
+        return !mRunnable.empty() || mStopping;
+      });
+      if (mStopping) {
+        return;
+      }
+      job = mRunnable.front();
+      mRunnable.pop_front();
+      if (!job->mCancel) {
+        task = job->mTasks[job->mNextTask++];
+        ++job->mRunningTasks;
+        hasTask = true;
+      }
+      else {
+        job->mNextTask = job->mTasks.size();
+      }
+      // Rotating jobs keeps concurrent requests progressing together.
+      if (job->mNextTask < job->mTasks.size()) {
+        mRunnable.push_back(job);
+      }
+    }
+
+    if (hasTask) {
+      Solver::Enumerate(
+        job->mSearch,
+        task,
+        [&job](const Sim::Placement& placement, const Sim::RunResult& result) {
+          return job->AddSolution(placement, result.mTick);
+        });
+    }
+
+    bool finished = false;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (hasTask) {
+        --job->mRunningTasks;
+      }
+      bool drained = job->mCancel || job->mNextTask == job->mTasks.size();
+      if (drained && job->mRunningTasks == 0 && !job->mFinished) {
+        job->mFinished = true;
+        finished = true;
+        // Only complete and decided searches can answer later requests.
+        if (!job->mCancel && job->mStats.mUndecided == 0) {
+          std::lock_guard<std::mutex> jobLock(job->mMutex);
+          CacheSolutions(job->mKey, job->mSolutions);
+        }
+        auto it = mInFlight.find(job->mKey);
+        if (it != mInFlight.end() && it->second == job) {
+          mInFlight.erase(it);
+        }
+      }
+    }
+    if (finished) {
+      job->Finish();
+    }
+  }
+}
+
+// Reads newline terminated lines from a socket.
+struct LineReader {
+  bool Next(std::string* line);
+
+  int mFd;
+  std::string mBuffer;
+};
+
+bool LineReader::Next(std::string* line) {
+  while (true) {
+    size_t newline = mBuffer.find('\n');
+    if (newline != std::string::npos) {
+      *line = mBuffer.substr(0, newline);
+      mBuffer.erase(0, newline + 1);
+      return true;
+    }
+    char chunk[4096];
+    ssize_t result = recv(mFd, chunk, sizeof(chunk), 0);
+    if (result <= 0) {
+      return false;
+    }
+    mBuffer.append(chunk, result);
+  }
+}
+
+// A client that only shut down its sending side still reads the answers. One
+// that closed the connection entirely never will.
+bool HungUp(int fd) {
+  pollfd entry = {fd, 0, 0};
+  return poll(&entry, 1, 0) > 0 && (entry.revents & (POLLHUP | POLLERR)) != 0;
+}
+
+// A connection can send any number of requests one after the other.
+void ServeClient(int fd) {
+  LineReader reader = {fd, {}};
+  Protocol::RequestParser parser;
+  std::string line;
+  bool connected = true;
+  while (connected && reader.Next(&line)) {
+    Protocol::ParseStatus status = parser.Feed(line);
+    if (status == Protocol::ParseStatus::Error) {
+      connected = WriteAll(fd, "error " + parser.mError + "\n");
+      parser = Protocol::RequestParser();
+      continue;
+    }
+    if (status == Protocol::ParseStatus::More) {
+      continue;
+    }
+
+    std::shared_ptr<Subscriber> subscriber = std::make_shared<Subscriber>();
+    std::shared_ptr<SearchJob> job =
+      nDaemon.Submit(std::move(parser.mRequest), subscriber);
+    parser = Protocol::RequestParser();
+    while (true) {
+      NextStatus next = subscriber->Next(&line, nHangUpInterval);
+      if (next == NextStatus::Done) {
+        break;
+      }
+      if (connected) {
+        connected = next == NextStatus::Line ? WriteAll(fd, line) : !HungUp(fd);
+      }
+      if (!connected && job != nullptr) {
+        job->Detach(subscriber);
+        job = nullptr;
+      }
+    }
+  }
+}
+
+// Written to by the signal handler and by every client thread that ends, so
+// the accept loop wakes up to stop or to take another client.
+int nWakeFds[2] = {-1, -1};
+volatile std::sig_atomic_t nStopping = 0;
+
+void Wake() {
+  char byte = 0;
+  ssize_t result = write(nWakeFds[1], &byte, 1);
+  (void)result;
+}
+
+void HandleSignal(int /*signal*/) {
+  nStopping = 1;
+  Wake();
+}
+
+// The accept loop owns the connections. A connection's socket is only closed
+// once its thread was joined, so the descriptor can't be reused under it.
+struct Connection {
+  int mFd;
+  std::atomic<bool> mDone = false;
+  std::thread mThread;
+};
+
+struct Connections {
+  void Add(int fd);
+  // Joins the threads of clients that left.
+  void Reap();
+  // Makes every client's reads and writes fail so its thread ends, then joins
+  // them all.
+  void ShutDown();
+
+  std::list<Connection> mConnections;
+};
+
+void Connections::Add(int fd) {
+  Connection& connection = mConnections.emplace_back();
+  connection.mFd = fd;
+  connection.mThread = std::thread([&connection]() {
+    ServeClient(connection.mFd);
+    connection.mDone = true;
+    Wake();
+  });
+}
+
+void Connections::Reap() {
+  for (auto it = mConnections.begin(); it != mConnections.end();) {
+    if (!it->mDone) {
+      ++it;
+      continue;
+    }
+    it->mThread.join();
+    close(it->mFd);
+    it = mConnections.erase(it);
+  }
+}
+
+void Connections::ShutDown() {
+  for (Connection& connection: mConnections) {
+    shutdown(connection.mFd, SHUT_RDWR);
+  }
+  for (Connection& connection: mConnections) {
+    connection.mThread.join();
+    close(connection.mFd);
+  }
+  mConnections.clear();
+}
+
+int main(int argc, char* argv[]) {
+  int workerCount = (int)std::thread::hardware_concurrency();
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+      nSocketPath = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+      workerCount = std::atoi(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "--no-prune") == 0) {
+      nPrune = false;
+    }
+    else {
+      std::fprintf(
+        stderr,
+        "usage: %s [--socket path] [--workers count] [--no-prune]\n",
+        argv[0]);
+      return 1;
+    }
+  }
+  workerCount = std::max(1, workerCount);
+
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (std::strlen(nSocketPath) >= sizeof(address.sun_path)) {
+    std::fprintf(stderr, "Socket path is too long.\n");
+    return 1;
+  }
+  std::strcpy(address.sun_path, nSocketPath);
+  int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(nSocketPath);
+  if (
+    listenFd < 0 || bind(listenFd, (sockaddr*)&address, sizeof(address)) < 0 ||
+    listen(listenFd, (int)nMaxClients) < 0) {
+    std::perror("Failed to listen");
+    return 1;
+  }
+  // The write end never blocks, so a full pipe can't stall a signal handler
+  // or a client thread. The wakeups already in it are enough.
+  if (pipe(nWakeFds) < 0 || fcntl(nWakeFds[1], F_SETFL, O_NONBLOCK) < 0) {
+    std::perror("Failed to create the wake pipe");
+    return 1;
+  }
+  std::signal(SIGINT, HandleSignal);
+  std::signal(SIGTERM, HandleSignal);
+
+  nDaemon.Start(workerCount);
+  std::printf("Listening on %s with %d workers\n", nSocketPath, workerCount);
+  std::fflush(stdout);
+  Connections connections;
+  while (!nStopping) {
+    connections.Reap();
+    // The listening socket is left alone while every client slot is taken.
+    pollfd entries[2] = {{nWakeFds[0], POLLIN, 0}, {listenFd, POLLIN, 0}};
+    bool room = connections.mConnections.size() < nMaxClients;
+    if (poll(entries, room ? 2 : 1, -1) < 0) {
+      continue;
+    }
+    if (entries[0].revents & POLLIN) {
+      char bytes[64];
+      ssize_t result = read(nWakeFds[0], bytes, sizeof(bytes));
+      (void)result;
+    }
+    if (room && (entries[1].revents & POLLIN)) {
+      int clientFd = accept(listenFd, nullptr, nullptr);
+      if (clientFd >= 0) {
+        connections.Add(clientFd);
+      }
+    }
+  }
+
+  close(listenFd);
+  unlink(nSocketPath);
+  connections.ShutDown();
+  nDaemon.Stop();
+  return 0;
+}
@@ -0,0 +1,289 @@
+#include <sstream>
+
+#include "Solver.h"
+#include "SolverProtocol.h"
+
+namespace Protocol {
+
+const char* DirectionName(Direction direction) {
+  switch (direction) {
+  case Direction::Up: return "up";
+  case Direction::Right: return "right";
+  case Direction::Down: return "down";
+  case Direction::Left: return "left";
+  }
+  return "";
+}
+
+bool ReadDirection(std::istream& stream, Direction* direction) {
+  std::string name;
+  stream >> name;
+  for (Direction option:
+       {Direction::Up, Direction::Right, Direction::Down, Direction::Left}) {
+    if (name == DirectionName(option)) {
+      *direction = option;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char* FilterTypeName(Filter::Type type) {
+  switch (type) {
+  case Filter::Type::Add: return "+";
+  case Filter::Type::Sub: return "-";
+  case Filter::Type::Mul: return "*";
+  case Filter::Type::Mod: return "%";
+  }
+  return "";
+}
+
+bool ReadFilterType(std::istream& stream, Filter::Type* type) {
+  std::string name;
+  stream >> name;
+  for (Filter::Type option:
+       {Filter::Type::Add,
+        Filter::Type::Sub,
+        Filter::Type::Mul,
+        Filter::Type::Mod}) {
+    if (name == FilterTypeName(option)) {
+      *type = option;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ReadPlaceable(std::istream& stream, bool* placeable) {
+  std::string name;
+  stream >> name;
+  *placeable = name == "placeable";
+  return *placeable || name == "locked";
+}
+
+RequestParser::RequestParser(): mHasLevel(false) {}
+
+ParseStatus RequestParser::Fail(const std::string& error) {
+  mError = error;
+  return ParseStatus::Error;
+}
+
+ParseStatus RequestParser::Feed(const std::string& line) {
+  std::istringstream stream(line);
+  std::string command;
+  if (!(stream >> command)) {
+    return ParseStatus::More;
+  }
+  Sim::LevelDesc& level = mRequest.mLevel;
+  if (command == "level") {
+    level = {};
+    mFixes.clear();
+    mHasLevel = false;
+    stream >> level.mWidth >> level.mHeight;
+    if (!stream) {
+      return Fail("Malformed level line.");
+    }
+    // Nothing is sized from the field yet, so an oversized one costs nothing.
+    if (!Sim::ValidFieldSize(level.mWidth, level.mHeight)) {
+      return Fail(
+        "The field must have a positive size of at most " +
+        std::to_string(Sim::nMaxFieldCells) + " cells.");
+    }
+    mHasLevel = true;
+    return ParseStatus::More;
+  }
+  if (!mHasLevel) {
+    return Fail("Requests must start with a level line.");
+  }
+
+  if (command == "digit") {
+    Digit digit;
+    stream >> digit.mCell[0] >> digit.mCell[1] >> digit.mValue;
+    if (!stream || !ReadDirection(stream, &digit.mDirection)) {
+      return Fail("Malformed digit line.");
+    }
+    level.mDigits.push_back(digit);
+  }
+  else if (command == "requirement") {
+    Requirement requirement;
+    stream >> requirement.mCell[0] >> requirement.mCell[1] >>
+      requirement.mValue;
+    if (!stream) {
+      return Fail("Malformed requirement line.");
+    }
+    level.mRequirements.push_back(requirement);
+  }
+  else if (command == "filter") {
+    Filter filter;
+    stream >> filter.mStartCell[0] >> filter.mStartCell[1];
+    bool valid = stream && ReadFilterType(stream, &filter.mType);
+    stream >> filter.mValue;
+    if (!valid || !stream || !ReadPlaceable(stream, &filter.mPlaceable)) {
+      return Fail("Malformed filter line.");
+    }
+    level.mFilters.push_back(filter);
+  }
+  else if (command == "shifter") {
+    Shifter shifter;
+    stream >> shifter.mStartCell[0] >> shifter.mStartCell[1];
+    bool valid = stream && ReadDirection(stream, &shifter.mDirection);
+    if (!valid || !ReadPlaceable(stream, &shifter.mPlaceable)) {
+      return Fail("Malformed shifter line.");
+    }
+    level.mShifters.push_back(shifter);
+  }
+  else if (command == "emitter") {
+    Emitter emitter;
+    stream >> emitter.mCell[0] >> emitter.mCell[1] >> emitter.mValue;
+    bool valid = stream && ReadDirection(stream, &emitter.mDirection);
+    stream >> emitter.mPeriod;
+    if (!valid || !stream) {
+      return Fail("Malformed emitter line.");
+    }
+    level.mEmitters.push_back(emitter);
+  }
+  else if (command == "sink") {
+    Sink sink;
+    stream >> sink.mCell[0] >> sink.mCell[1];
+    if (!stream) {
+      return Fail("Malformed sink line.");
+    }
+    level.mSinks.push_back(sink);
+  }
+  else if (command == "fix") {
+    int placeableIdx, cell[2];
+    stream >> placeableIdx >> cell[0] >> cell[1];
+    if (!stream) {
+      return Fail("Malformed fix line.");
+    }
+    int cellIdx = Sim::nNoCell;
+    if (cell[0] != -1 || cell[1] != -1) {
+      if (!CellInField(cell, level.mWidth, level.mHeight)) {
+        return Fail("Fixed cell is outside of the field.");
+      }
+      cellIdx = cell[1] * level.mWidth + cell[0];
+    }
+    mFixes.push_back({placeableIdx, cellIdx});
+  }
+  else if (command == "solve") {
+    stream >> mRequest.mMaxSolutions >> mRequest.mMaxTicks;
+    if (!stream || mRequest.mMaxSolutions < 0 || mRequest.mMaxTicks < 0) {
+      return Fail("Malformed solve line.");
+    }
+    std::string error;
+    if (!Sim::ValidLevelDesc(level, &error)) {
+      return Fail(error);
+    }
+    if (mRequest.mMaxTicks == 0) {
+      mRequest.mMaxTicks = Sim::DefaultMaxTicks(level);
+    }
+
+    // Fixed cells have to be cells the game would let a player use.
+    int placeableCount = Sim::PlaceableCount(level);
+    mRequest.mPartial.assign(placeableCount, Solver::nFreeCell);
+    Sim::Placement fixedPlacement(placeableCount, Sim::nNoCell);
+    for (const std::pair<int, int>& fix: mFixes) {
+      if (fix.first < 0 || fix.first >= placeableCount) {
+        return Fail("Fixed placeable does not exist.");
+      }
+      mRequest.mPartial[fix.first] = fix.second;
+      fixedPlacement[fix.first] = fix.second;
+    }
+    Sim::Board board;
+    if (!board.Init(level, fixedPlacement)) {
+      return Fail("Fixed cells can't hold a modifier.");
+    }
+    mHasLevel = false;
+    return ParseStatus::Done;
+  }
+  else {
+    return Fail("Unknown command " + command + ".");
+  }
+  return ParseStatus::More;
+}
+
+std::string WriteLevel(const Sim::LevelDesc& levelDesc) {
+  std::ostringstream stream;
+  stream << "level " << levelDesc.mWidth << " " << levelDesc.mHeight << "\n";
+  for (const Digit& digit: levelDesc.mDigits) {
+    stream << "digit " << digit.mCell[0] << " " << digit.mCell[1] << " "
+           << digit.mValue << " " << DirectionName(digit.mDirection) << "\n";
+  }
+  for (const Requirement& requirement: levelDesc.mRequirements) {
+    stream << "requirement " << requirement.mCell[0] << " "
+           << requirement.mCell[1] << " " << requirement.mValue << "\n";
+  }
+  for (const Filter& filter: levelDesc.mFilters) {
+    int x = filter.mPlaceable ? -1 : filter.mStartCell[0];
+    int y = filter.mPlaceable ? -1 : filter.mStartCell[1];
+    stream << "filter " << x << " " << y << " " << FilterTypeName(filter.mType)
+           << " " << filter.mValue << " "
+           << (filter.mPlaceable ? "placeable" : "locked") << "\n";
+  }
+  for (const Shifter& shifter: levelDesc.mShifters) {
+    int x = shifter.mPlaceable ? -1 : shifter.mStartCell[0];
+    int y = shifter.mPlaceable ? -1 : shifter.mStartCell[1];
+    stream << "shifter " << x << " " << y << " "
+           << DirectionName(shifter.mDirection) << " "
+           << (shifter.mPlaceable ? "placeable" : "locked") << "\n";
+  }
+  for (const Emitter& emitter: levelDesc.mEmitters) {
+    stream << "emitter " << emitter.mCell[0] << " " << emitter.mCell[1] << " "
+           << emitter.mValue << " " << DirectionName(emitter.mDirection) << " "
+           << emitter.mPeriod << "\n";
+  }
+  for (const Sink& sink: levelDesc.mSinks) {
+    stream << "sink " << sink.mCell[0] << " " << sink.mCell[1] << "\n";
+  }
+  return stream.str();
+}
+
+void WriteCell(std::ostream& stream, int width, int cell) {
+  if (cell < 0) {
+    stream << " -1 -1";
+    return;
+  }
+  stream << " " << cell % width << " " << cell / width;
+}
+
+std::string WriteFixes(
+  const Sim::LevelDesc& levelDesc, const Sim::Placement& partial) {
+  std::ostringstream stream;
+  for (size_t i = 0; i < partial.size(); ++i) {
+    if (partial[i] != Solver::nFreeCell) {
+      stream << "fix " << i;
+      WriteCell(stream, levelDesc.mWidth, partial[i]);
+      stream << "\n";
+    }
+  }
+  return stream.str();
+}
+
+std::string WriteRequest(const Request& request) {
+  std::ostringstream stream;
+  stream << WriteLevel(request.mLevel)
+         << WriteFixes(request.mLevel, request.mPartial) << "solve "
+         << request.mMaxSolutions << " " << request.mMaxTicks << "\n";
+  return stream.str();
+}
+
+std::string WriteSolution(
+  const Sim::LevelDesc& levelDesc, const Sim::Placement& placement, int tick) {
+  std::ostringstream stream;
+  stream << "solution " << tick;
+  for (int cell: placement) {
+    WriteCell(stream, levelDesc.mWidth, cell);
+  }
+  stream << "\n";
+  return stream.str();
+}
+
+std::string RequestKey(const Request& request) {
+  std::ostringstream stream;
+  stream << WriteLevel(request.mLevel)
+         << WriteFixes(request.mLevel, request.mPartial) << "ticks "
+         << request.mMaxTicks << "\n";
+  return stream.str();
+}
+
+} // namespace Protocol
@@ -0,0 +1,81 @@
+#ifndef SolverProtocol_h
+#define SolverProtocol_h
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Simulation.h"
+
+// The line based text protocol spoken between the solver daemon and its
+// clients. A request describes a level and ends with a solve line.
+//
+//   level <width> <height>
+//   digit <x> <y> <value> <up|right|down|left>
+//   requirement <x> <y> <value>
+//   filter <x> <y> <+|-|*|%> <value> <locked|placeable>
+//   shifter <x> <y> <up|right|down|left> <locked|placeable>
+//   emitter <x> <y> <value> <up|right|down|left> <period>
+//   sink <x> <y>
+//   fix <placeable> <x> <y>
+//   solve <maxSolutions> <maxTicks>
+//
+// A field has at most Sim::nMaxFieldCells cells and larger level lines are
+// rejected. Placeable modifiers use -1 -1 for their cell. A fix line pins a
+// placeable (indexed as in Sim::Placement) to a cell, or to the palette with
+// -1 -1. A maxSolutions of 0 asks for every solution and a maxTicks of 0 uses
+// Sim::DefaultMaxTicks. The daemon streams back one line per solution as it is
+// found and finishes with a done line. It counts the placements simulated or
+// found in the transposition cache, the partial placements the reachability
+// pre-pass ruled out and the complete placements those skipped. A search stops
+// after nMaxSolutions solutions however many were asked for, and one stopped
+// early is not cached.
+//
+// Every placement is simulated for at most maxTicks. A run that gets there
+// without solving, settling or coming back to an earlier state might still
+// solve later. Such placements are counted as undecided instead of being
+// ruled out, and a search with any of them is not cached.
+//
+//   solution <tick> <x> <y> ...
+//   done <solutions> <placements> <pruned> <skipped> <undecided> <source>
+//
+// The source is searched, joined or cached.
+//   error <message>
+namespace Protocol {
+
+constexpr int nMaxSolutions = 1 << 16;
+
+struct Request {
+  Sim::LevelDesc mLevel;
+  // Cells are Solver::nFreeCell unless a fix line pinned them.
+  Sim::Placement mPartial;
+  int mMaxSolutions;
+  int mMaxTicks;
+};
+
+enum class ParseStatus { More, Done, Error };
+struct RequestParser {
+  RequestParser();
+  // Consumes one line. Done means mRequest holds a complete request.
+  ParseStatus Feed(const std::string& line);
+
+  Request mRequest;
+  std::string mError;
+
+private:
+  ParseStatus Fail(const std::string& error);
+  bool mHasLevel;
+  // Pairs of a placeable index and the cell index it is fixed to.
+  std::vector<std::pair<int, int>> mFixes;
+};
+
+std::string WriteLevel(const Sim::LevelDesc& levelDesc);
+std::string WriteRequest(const Request& request);
+std::string WriteSolution(
+  const Sim::LevelDesc& levelDesc, const Sim::Placement& placement, int tick);
+// Requests with the same key have the same answers.
+std::string RequestKey(const Request& request);
+
+} // namespace Protocol
+
+#endif
@@ -0,0 +1,16 @@
+#include <sys/socket.h>
+
+#include "SolverSocket.h"
+
+bool WriteAll(int fd, const std::string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t result =
+      send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+    if (result <= 0) {
+      return false;
+    }
+    written += result;
+  }
+  return true;
+}
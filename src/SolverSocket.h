@@ -0,0 +1,11 @@
+#ifndef SolverSocket_h
+#define SolverSocket_h
+
+#include <string>
+
+// Sends all of data over a connected socket, retrying short writes. Returns
+// false when the connection fails first. A peer that went away doesn't raise
+// SIGPIPE.
+bool WriteAll(int fd, const std::string& data);
+
+#endif